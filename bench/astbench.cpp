@@ -0,0 +1,118 @@
+/* ---------------------------------------------------------------------
+   ---- astbench: bytes per AST node, and nodes per second of a --------
+   ---- plain walk over the tree and of sem(), on the trees of the -----
+   ---- given programs, parsed again and again up to a node count ------
+   --------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "ast.hpp"
+#include "compile.hpp"
+#include "source.hpp"
+#include "trace.hpp"
+
+extern thread_local ASTNode *t;
+int yyparse();
+
+static const char *classNames[] = {
+  "ASTId", "ASTInt", "ASTChar", "ASTString", "ASTVdef", "ASTSeq", "ASTFdef",
+  "ASTFdecl", "ASTPar", "ASTAssign", "ASTFcall", "ASTFcall_stmt", "ASTIf",
+  "ASTIfelse", "ASTWhile", "ASTRet", "ASTOp"
+};
+
+static const size_t classSizes[] = {
+  sizeof(ASTId), sizeof(ASTInt), sizeof(ASTChar), sizeof(ASTString), sizeof(ASTVdef),
+  sizeof(ASTSeq), sizeof(ASTFdef), sizeof(ASTFdecl), sizeof(ASTPar), sizeof(ASTAssign),
+  sizeof(ASTFcall), sizeof(ASTFcall_stmt), sizeof(ASTIf), sizeof(ASTIfelse),
+  sizeof(ASTWhile), sizeof(ASTRet), sizeof(ASTOp)
+};
+
+#define CLASSES (sizeof(classNames) / sizeof(classNames[0]))
+
+static long counts[CLASSES];
+
+// nodes of the tree, counted by class
+static void census(ASTNode *n) {
+  for (; n != nullptr; n = n->right) {
+    counts[n->nodeKind]++;
+    census(n->left);
+  }
+}
+
+// what every pass does at least: visit each node once and look at it
+static long walk(ASTNode *n) {
+  long lines = 0;
+  for (; n != nullptr; n = n->right) {
+    lines += n->line + n->nodeKind;
+    lines += walk(n->left);
+  }
+  return lines;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<const char *> files;
+  std::vector<ASTNode *> trees;
+  long wanted = 1000000, nodes = 0;
+  size_t bytes = 0;
+  for (int i = 1; i < argc; i++)
+    if (!strcmp(argv[i], "-n") && i + 1 < argc) wanted = atol(argv[++i]);
+    else files.push_back(argv[i]);
+  if (files.empty() || wanted <= 0) {
+    fprintf(stderr, "usage: astbench [-n nodes] file...\n");
+    return 1;
+  }
+
+  // the programs, again and again, up to the number of nodes wanted
+  while (nodes < wanted)
+    for (const char *name : files) {
+      filename = name;
+      openSource(name);
+      linecount = 1;
+      scanSource();
+      if (yyparse()) return 1;
+      trees.push_back(t);
+      long before[CLASSES];
+      memcpy(before, counts, sizeof(counts));
+      census(t);
+      for (size_t k = 0; k < CLASSES; k++) {
+        nodes += counts[k] - before[k];
+        bytes += (counts[k] - before[k]) * classSizes[k];
+      }
+    }
+
+  printf("%zu trees, %ld nodes, %zu bytes: %.1f bytes per node\n",
+         trees.size(), nodes, bytes, (double) bytes / nodes);
+  for (size_t k = 0; k < CLASSES; k++)
+    if (counts[k] > 0)
+      printf("  %-14s %3zu bytes %10ld nodes %5.1f%%\n",
+             classNames[k], classSizes[k], counts[k], counts[k] * 100.0 / nodes);
+
+  // sem() warns about every function without a return; not here
+  if (freopen("/dev/null", "w", stderr) == NULL) return 1;
+
+  long long best[2] = { 0, 0 };
+  long sink = 0;
+  for (int run = 0; run < 5; run++) {
+    long long start = traceNow();
+    for (ASTNode *tree : trees) sink += walk(tree);
+    long long ns = traceNow() - start;
+    if (run == 0 || ns < best[0]) best[0] = ns;
+
+    ns = 0;
+    for (ASTNode *tree : trees) {
+      prepareCompiler();
+      start = traceNow();
+      tree->sem();
+      ns += traceNow() - start;
+      closeScope();
+      destroySymbolTable();
+    }
+    if (run == 0 || ns < best[1]) best[1] = ns;
+  }
+  printf("walk %8.1f Mnodes/s\n", nodes * 1e3 / best[0]);
+  printf("sem  %8.1f Mnodes/s\n", nodes * 1e3 / best[1]);
+  return sink == 0;
+}
@@ -0,0 +1,137 @@
+/* ---------------------------------------------------------------------
+   ---- lexbench: tokens per second of the scanner of bin/alan ---------
+   ---- (src/scanner.cpp) and of the flex lexer it replaced -----------
+   ---- (src/lexer.l), on the same input; they must also agree on ------
+   ---- every token, its value and its line ---------------------------
+   --------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "ast.hpp"
+#include "source.hpp"
+#include "trace.hpp"
+#include "parser.hpp"
+
+YYSTYPE yylval;
+thread_local const char *filename = "lexbench";
+
+int yylex(YYSTYPE *lval);
+int flex_lex();
+void flexScanSource();
+
+// the scanner hands the value of a token back through a pointer, as the
+// (pure) parser wants it
+static int scanner_lex() {
+  return yylex(&yylval);
+}
+
+static long illegal = 0;
+
+// an illegal token is not the end of the input for the benchmark
+void yyerror (const char *msg) {
+  illegal++;
+}
+
+typedef struct {
+  const char *name;
+  void (*start)();
+  int (*next)();
+} Lexer;
+
+static const Lexer lexers[] = {
+  { "flex",    flexScanSource, flex_lex    },
+  { "scanner", scanSource,     scanner_lex }
+};
+
+typedef struct {
+  int token;
+  int line;
+  long value;     // number, character, symbol, or offset of the span
+  int length;     // of the span
+} Token;
+
+static std::vector<Token> tokens(const Lexer &lexer) {
+  std::vector<Token> all;
+  Token t;
+  linecount = 1;
+  lexer.start();
+  do {
+    t.token = lexer.next();
+    t.line = linecount;
+    t.value = t.length = 0;
+    if (t.token == T_const) t.value = yylval.n;
+    else if (t.token == T_char) t.value = yylval.c;
+    else if (t.token == T_id) t.value = (long) yylval.sym;
+    else if (t.token == T_string) {
+      t.value = yylval.span.text - sourceText;
+      t.length = yylval.span.length;
+    }
+    all.push_back(t);
+  } while (t.token != 0);
+  return all;
+}
+
+// the files, again and again, up to size bytes
+static void makeSource(const std::vector<std::string> &files, size_t size) {
+  std::string text;
+  while (text.size() < size)
+    for (const std::string &name : files) {
+      FILE *f = fopen(name.c_str(), "r");
+      char buf[4096];
+      size_t n;
+      if (f == NULL) fatal("\rcannot open %s", name.c_str());
+      while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+      fclose(f);
+      text += '\n';
+    }
+  sourceText = (char *) mynew(text.size() + SOURCE_PADDING);
+  memcpy(sourceText, text.data(), text.size());
+  memset(sourceText + text.size(), 0, SOURCE_PADDING);
+  sourceLength = text.size();
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<std::string> files;
+  size_t mib = 64;
+  for (int i = 1; i < argc; i++)
+    if (!strcmp(argv[i], "-n") && i + 1 < argc) mib = atol(argv[++i]);
+    else files.push_back(argv[i]);
+  if (files.empty() || mib == 0) {
+    fprintf(stderr, "usage: lexbench [-n MiB] file...\n");
+    return 1;
+  }
+  makeSource(files, mib << 20);
+
+  // the same tokens first, or the numbers mean nothing
+  std::vector<Token> expected = tokens(lexers[0]), got = tokens(lexers[1]);
+  for (size_t i = 0; i < expected.size(); i++) {
+    const Token &e = expected[i], &g = i < got.size() ? got[i] : expected[i];
+    if (i >= got.size() || e.token != g.token || e.line != g.line ||
+        e.value != g.value || e.length != g.length) {
+      fprintf(stderr, "token %zu differs: flex says %d (line %d, value %ld, length %d), "
+              "the scanner %d (line %d, value %ld, length %d)\n", i,
+              e.token, e.line, e.value, e.length, g.token, g.line, g.value, g.length);
+      return 1;
+    }
+  }
+  printf("%.1f MiB, %zu tokens, %ld illegal, %d lines\n",
+         sourceLength / 1048576.0, expected.size(), illegal / 2, expected.back().line);
+
+  for (const Lexer &lexer : lexers) {
+    long long best = 0;
+    for (int run = 0; run < 5; run++) {
+      long long start = traceNow();
+      lexer.start();
+      while (lexer.next() != 0) {}
+      long long ns = traceNow() - start;
+      if (run == 0 || ns < best) best = ns;
+    }
+    printf("%-8s %8.1f Mtokens/s %8.1f MiB/s\n", lexer.name,
+           expected.size() * 1e3 / best, sourceLength / 1048576.0 * 1e9 / best);
+  }
+  return 0;
+}
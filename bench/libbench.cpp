@@ -0,0 +1,101 @@
+/* ---------------------------------------------------------------------
+   ---- libbench: compiles per second of libalan (alanCompile()), on ---
+   ---- one thread and on many at once, over the given programs; the --
+   ---- threads must get exactly what one thread got, diagnostics -----
+   ---- included ------------------------------------------------------
+   --------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "alan.hpp"
+#include "trace.hpp"
+
+typedef struct {
+  const char *name;
+  std::string text;
+} Program;
+
+// all of a result, to compare
+static std::string summary(const AlanResult &r) {
+  std::string s = r.ok ? "ok\n" : "failed\n";
+  for (const AlanDiagnostic &d : r.diagnostics)
+    s += std::to_string(d.severity) + ":" + std::to_string(d.line) + ": " + d.message + "\n";
+  return s + r.ll + r.object;
+}
+
+static AlanResult compileProgram(const Program &p) {
+  AlanRequest request;
+  request.name = p.name;
+  request.optLevel = ALAN_O2;
+  request.ll = true;
+  request.object = true;
+  return alanCompile(p.text.data(), p.text.size(), request);
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<Program> programs;
+  int threads = std::thread::hardware_concurrency(), rounds = 5;
+  for (int i = 1; i < argc; i++)
+    if (!strcmp(argv[i], "-t") && i + 1 < argc) threads = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-n") && i + 1 < argc) rounds = atoi(argv[++i]);
+    else {
+      std::ifstream in(argv[i], std::ios::binary);
+      std::stringstream text;
+      text << in.rdbuf();
+      programs.push_back({ argv[i], text.str() });
+    }
+  if (programs.empty() || threads <= 0 || rounds <= 0) {
+    fprintf(stderr, "usage: libbench [-t threads] [-n rounds] file...\n");
+    return 1;
+  }
+
+  // one thread: the results to expect, and the time to beat
+  std::vector<std::string> expected;
+  long long start = traceNow();
+  for (const Program &p : programs) expected.push_back(summary(compileProgram(p)));
+  for (int round = 1; round < rounds; round++)
+    for (size_t k = 0; k < programs.size(); k++)
+      if (summary(compileProgram(programs[k])) != expected[k]) {
+        fprintf(stderr, "libbench: %s compiles differently the second time\n", programs[k].name);
+        return 1;
+      }
+  long long serial = traceNow() - start;
+
+  // every thread compiles every program, each starting at another one
+  std::atomic<long> mismatches(0);
+  std::vector<std::thread> workers;
+  start = traceNow();
+  for (int w = 0; w < threads; w++)
+    workers.emplace_back([&, w] {
+      for (int round = 0; round < rounds; round++)
+        for (size_t i = 0; i < programs.size(); i++) {
+          size_t k = (i + w) % programs.size();
+          if (summary(compileProgram(programs[k])) != expected[k]) {
+            fprintf(stderr, "libbench: %s compiles differently on thread %d\n", programs[k].name, w);
+            mismatches++;
+          }
+        }
+    });
+  for (std::thread &t : workers) t.join();
+  long long parallel = traceNow() - start;
+
+  long compiles = (long) programs.size() * rounds;
+  printf("%zu programs, %d rounds\n", programs.size(), rounds);
+  printf("1 thread   %8.1f compiles/s\n", compiles * 1e9 / serial);
+  printf("%-2d threads %8.1f compiles/s (%.1fx)\n", threads,
+         compiles * threads * 1e9 / parallel, (double) serial * threads / parallel);
+  if (mismatches > 0) {
+    printf("%ld compiles differ from those of one thread\n", mismatches.load());
+    return 1;
+  }
+  printf("every compile the same as on one thread\n");
+  return 0;
+}
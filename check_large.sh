@@ -0,0 +1,35 @@
+#!/bin/bash
+
+# regression test for the parser's old statement limit: one function of
+# a million statements must compile (to IR: the backend alone would take
+# minutes), with one addition in the IR for each statement
+
+statements=1000000
+infile=$(mktemp /tmp/alanXXXXXX.alan)
+irfile=$(mktemp /tmp/alanXXXXXX.ll)
+trap "rm -f $infile $irfile" EXIT
+
+{
+	echo "large () : int"
+	echo "  x : int;"
+	echo "{"
+	echo "  x = 0;"
+	yes "  x = x + 1;" | head -n $statements
+	echo "  return x;"
+	echo "}"
+} > $infile
+
+echo "compiling a function of $statements statements"
+# the IR goes to a file, so that a crash after some of it is not missed
+./alanc -i < $infile > $irfile
+status=$?
+if [[ $status -ne 0 ]]; then
+	echo "failed: alanc exited with status $status"
+	exit 1
+fi
+adds=$(grep -c ' = add ' $irfile)
+if [[ $adds -ne $statements ]]; then
+	echo "failed: $adds additions in the IR"
+	exit 1
+fi
+echo "ok"
@@ -1,25 +1,23 @@
 #!/bin/bash
 
+# options given (e.g. --single-pass) are passed on to alanc
+
 for dir in $(find -iname should_run); do
 	for infile in $(ls $dir/*.alan); do
 
 		echo " === checking file $infile ==="
 
-		./alanc -x $infile
-
 		INPUTFILE=$dir/$(basename $infile .alan).stdin
 		OUTPUTFILE=$dir/$(basename $infile .alan).stdout
 
 		# *.stdin file does not exist; just compare output to *.stdout file
 		if [ ! -f $INPUTFILE ]; then
-			diff $OUTPUTFILE <(./a.out)
+			diff $OUTPUTFILE <(./alanc --run "$@" $infile)
 			continue
 		fi
 
-		# *.stdin file exists; feed it to a.out and then compare output to *.stdout file
-		diff $OUTPUTFILE <(./a.out < $INPUTFILE)
+		# *.stdin file exists; feed it to the program and then compare output to *.stdout file
+		diff $OUTPUTFILE <(./alanc --run "$@" $infile < $INPUTFILE)
 
 	done
 done
-
-rm a.out
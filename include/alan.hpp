@@ -0,0 +1,65 @@
+#ifndef __ALAN_HPP__
+#define __ALAN_HPP__
+
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* ---------------------------------------------------------------------
+   ---- libalan (lib/libalan.a): the compiler of bin/alan as a ---------
+   ---- library, for programs that compile Alan in-process: a source --
+   ---- in memory goes in, its IR, bitcode, assembly or object code ----
+   ---- comes out in memory, and so do the diagnostics; it never -------
+   ---- exits or writes to stderr, and any number of threads can -------
+   ---- compile at once (each one with a compiler of its own) ----------
+   --------------------------------------------------------------------- */
+
+namespace llvm {
+class LLVMContext;
+class Module;
+}
+
+typedef enum { ALAN_WARNING, ALAN_ERROR, ALAN_FATAL, ALAN_INTERNAL } AlanSeverity;
+
+typedef struct {
+  AlanSeverity severity;
+  int line;              // 0 if it is not about a line
+  std::string message;   // as bin/alan prints it, without the colours
+} AlanDiagnostic;
+
+// as -O0 ... -Oz
+typedef enum { ALAN_O0, ALAN_O1, ALAN_O2, ALAN_O3, ALAN_Os, ALAN_Oz } AlanOptLevel;
+
+struct AlanRequest {
+  const char *name = "input";          // of the module, in diagnostics too
+  AlanOptLevel optLevel = ALAN_O0;
+  const char *cpu = nullptr;           // -mcpu (NULL is generic)
+  const char *features = nullptr;      // -mattr (NULL is none)
+  bool singlePass = false;             // --single-pass
+  bool ll = false;                     // the outputs wanted: LLVM IR,
+  bool bc = false;                     // bitcode,
+  bool assembly = false;               // assembly
+  bool object = false;                 // and object code
+  llvm::LLVMContext *context = nullptr; // if given, the module too, in it
+                                        // (not to be used by another
+                                        // thread during the call)
+};
+
+struct AlanResult {
+  bool ok;                                  // compiled, without errors
+  std::vector<AlanDiagnostic> diagnostics;  // in the order they were found
+  std::string ll, bc, assembly, object;     // those wanted, if ok
+  std::unique_ptr<llvm::Module> module;     // if ok and a context was given
+
+  AlanResult();
+  AlanResult(AlanResult &&);
+  AlanResult &operator=(AlanResult &&);
+  ~AlanResult();
+};
+
+// compile source[0..length) (Alan, or a checked AST of --emit-ast) as
+// bin/alan would with the options of request
+AlanResult alanCompile(const char *source, size_t length, const AlanRequest &request);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef __ARENA_HPP__
+#define __ARENA_HPP__
+
+#include <stddef.h>
+
+#include "memreport.hpp"
+
+/* ---------------------------------------------------------------------
+   ---- arenas: objects that die together are bumped out of a few ------
+   ---- big chunks, and freed all at once with them, or all those -----
+   ---- since a mark at once, when they die in stack order ------------
+   --------------------------------------------------------------------- */
+
+class Arena {
+private:
+  struct Chunk {
+    Chunk *next;
+    size_t size;             // after this header
+  };
+  Chunk *chunks = nullptr;   // the newest first
+  char *next = nullptr;      // free space in the newest chunk
+  size_t left = 0;
+  size_t chunkSize = 0;      // of the newest chunk; they double
+  Chunk *spare = nullptr;    // the biggest one rewind() emptied
+  MemSubsystem subsystem;    // that --mem-report counts the chunks for
+
+  void *grow(size_t size);
+
+public:
+  constexpr Arena(MemSubsystem s = MEM_AST) : subsystem(s) {};
+  ~Arena() { release(); };
+
+  // where the next allocation would go
+  struct Mark {
+    Chunk *chunk;
+    char *next;
+    size_t left;
+  };
+
+  // size bytes, 8-aligned, that live until release()
+  void *allocate(size_t size) {
+    size = (size + 7) & ~(size_t) 7;
+    if (size > left) return grow(size);
+    void *p = next;
+    next += size;
+    left -= size;
+    return p;
+  };
+
+  // a NUL-terminated copy of text[0..length)
+  char *copy(const char *text, int length);
+
+  Mark mark() const { return { chunks, next, left }; };
+
+  // free everything allocated since m (in O(1), unless whole chunks
+  // were filled since)
+  void rewind(const Mark &m);
+
+  // free everything allocated so far
+  void release();
+};
+
+// the AST of the program being compiled, and its strings
+extern thread_local Arena astArena;
+
+#endif
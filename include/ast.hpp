@@ -3,187 +3,249 @@
 
 #include <iostream>
 #include <string>
+#include "arena.hpp"
 #include "general.hpp"
+#include "source.hpp"
 #include "symbol.hpp"
 
 #include <llvm/IR/Value.h>
 
 using namespace std;
 
-typedef enum {
+typedef enum : unsigned char {
   EQ, NE, LE, GE, LT, GT, AND, OR, NOT, // condition operators
   TRUE_, FALSE_,                        // constant condition operators
-  PLUS, MINUS, TIMES, DIV, MOD,         // expression operators
-  STRING, INTEGER                       // needed for codegen :(
+  PLUS, MINUS, TIMES, DIV, MOD          // expression operators
 } kind;
 
+// the class of a node: sem() and codegen() dispatch on it
+typedef enum : unsigned char {
+  AST_ID, AST_INT, AST_CHAR, AST_STRING, AST_VDEF, AST_SEQ, AST_FDEF,
+  AST_FDECL, AST_PAR, AST_ASSIGN, AST_FCALL, AST_FCALL_STMT, AST_IF,
+  AST_IFELSE, AST_WHILE, AST_RET, AST_OP
+} NodeKind;
+
 /* ---------------------------------------------------------------------
    ---------------------- Abstract AST Node Class ----------------------
-   --------------------------------------------------------------------- */
+   ---------------------------------------------------------------------
+   no vtable: a one byte tag says what class a node is, and what is
+   common to all of them fits in 32 bytes; the rest (names, numbers,
+   sem annotations) is kept only by the classes that have it
+ ----------------------------------------------------------------------- */
 
 class ASTNode {
 
 public:
-  int line = linecount;  // line number
+  NodeKind nodeKind;     // class of the node
   kind op;               // kind of operation (ASTOp only)
-  string id;             // name (vars, functions, chars)
-  Type type;             // var, function, expression type
-  int num;               // numeric value of ints/bytes
+  PassMode pm : 8;       // ASTPar only
+  int line = linecount;  // line number
+  Type type = nullptr;   // var, function, expression type
   ASTNode *left, *right; // left and right (generic) AST nodes
-  PassMode pm;           // ASTPar only
-  int nesting_diff;      // ASTId and ASTAssign only
-  int offset;            // ASTId and ASTAssign only
-  int num_vars;          // ASTFdecl only
 
-  virtual void sem() = 0;
-  virtual llvm::Value * codegen() = 0;
+  void sem();
+  llvm::Value * codegen();
 
-protected:
-  // various constructors needed by children classes
-  ASTNode(string s, ASTNode *l) : id(s), left(l) {};
-  ASTNode(int n) : op(INTEGER), num(n) {};
-  ASTNode(char c) { id = c; };
-  ASTNode(string s) : op(STRING), id(s) {};
-  ASTNode(string s, Type t, int n) : id(s) {
-    if (n == 0)
-      this->type = t;
-    else // this variable is an array
-      this->type = typeArray(n, t);
-  };
-  ASTNode(string s, Type t, ASTNode *l, ASTNode *r) : id(s), type(t), left(l), right(r) {};
-  ASTNode(string s, Type t, PassMode pm) : id(s), type(t), pm(pm) {};
-  ASTNode(ASTNode *l, kind op, ASTNode *r) : op(op), left(l), right(r) {};
-  ASTNode(ASTNode *l) : left(l) {};
-  ASTNode(ASTNode *l, ASTNode *r) : left(l), right(r) {};
+  // the name of an ASTId, ASTFcall, ASTVdef, ASTFdecl or ASTPar, the
+  // text of an ASTString (after sem), the byte of an ASTChar as a name,
+  // and nullptr for the rest
+  Symbol name();
 
-public:
-  virtual ~ASTNode() {
-    delete left;
-    delete right;
-  };
+  // nodes live in astArena and are freed with it, all at once: there
+  // is nothing to delete one by one
+  static void * operator new(size_t size) { return astArena.allocate(size); };
+  static void operator delete(void *) {};
+
+protected:
+  ASTNode(NodeKind k, ASTNode *l = nullptr, ASTNode *r = nullptr) : nodeKind(k), left(l), right(r) {};
 };
 
 /* ---------------------------------------------------------------------
    ------ AST Node Classes used in the AST representation of input -----
-   --------------------------------------------------------------------- */
+   ---------------------------------------------------------------------
+   sem() resolves names for codegen: a function has a frame of slots,
+   its parameters first, then the variables of the enclosing function
+   it takes as parameters too (all of those that it can name), then its
+   own variables, one that hides a variable it took taking its slot;
+   an ASTId or ASTVdef has the slot of its variable, and functions are
+   numbered in the order they are declared, those of the library first
+   (see initLibFunctions()), in which codegen creates them; a list of
+   slots is how many, then the slots
+ ----------------------------------------------------------------------- */
 
 class ASTId : public ASTNode {
 public:
-  ASTId(string id, ASTNode *index) : ASTNode(id, index) {};
+  Symbol id;             // interned
+  int slot = -1;         // set by sem(); -1 if it names no variable
+  ASTId(Symbol id, ASTNode *index) : ASTNode(AST_ID, index), id(id) {};
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTInt : public ASTNode {
 public:
-  ASTInt(int n) : ASTNode(n) {};
+  int num;
+  ASTInt(int n) : ASTNode(AST_INT), num(n) {};
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTChar : public ASTNode {
 public:
-  ASTChar(char c) : ASTNode(c) {};
+  char c;
+  ASTChar(char c) : ASTNode(AST_CHAR), c(c) {};
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTString : public ASTNode {
 public:
-  ASTString(string id) : ASTNode(id) {};
+  Span literal;          // as written, quotes and escapes included; sem()
+                         // decodes it into id
+  Symbol id = nullptr;
+  ASTString(Span literal) : ASTNode(AST_STRING), literal(literal) {};
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTVdef : public ASTNode {
 public:
-  ASTVdef(string id, Type type, int n) : ASTNode(id, type, n) {};
+  Symbol id;
+  int slot = -1;         // set by sem()
+  ASTVdef(Symbol id, Type t, int n) : ASTNode(AST_VDEF), id(id) {
+    if (n == 0)
+      type = t;
+    else // this variable is an array
+      type = typeArray(n, t);
+  };
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTSeq : public ASTNode {
 public:
-  ASTSeq(ASTNode *hd, ASTNode *tl) : ASTNode(hd, tl) {};
+  ASTSeq(ASTNode *hd, ASTNode *tl) : ASTNode(AST_SEQ, hd, tl) {};
   void sem();
   llvm::Value * codegen();
 };
 
+// a chain of ASTSeq that the parser is still appending to
+typedef struct {
+  ASTNode *head, *last;
+} ASTList;
+
 class ASTFdef : public ASTNode {
 public:
-  ASTFdef(ASTNode *fdecl, ASTNode *body) : ASTNode(fdecl, body) {};
+  ASTFdef(ASTNode *fdecl, ASTNode *body) : ASTNode(AST_FDEF, fdecl, body) {};
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTFdecl : public ASTNode {
 public:
-  ASTFdecl(string name, Type t, ASTNode *params, ASTNode *locdef) : ASTNode(name, t, params, locdef) {};
+  Symbol id;
+  int num_vars;          // set by sem()
+  const int *outer = nullptr; // set by sem(): the slots, in the frame
+                         // of the enclosing function, that it takes
+  ASTFdecl(Symbol name, Type t, ASTNode *params, ASTNode *locdef) : ASTNode(AST_FDECL, params, locdef), id(name) {
+    type = t;
+  };
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTPar : public ASTNode {
 public:
-  ASTPar(string name, Type t, PassMode pm) : ASTNode(name, t, pm) {};
+  Symbol id;
+  ASTPar(Symbol name, Type t, PassMode pm) : ASTNode(AST_PAR), id(name) {
+    type = t;
+    this->pm = pm;
+  };
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTAssign : public ASTNode {
 public:
-  ASTAssign(ASTNode *lval, ASTNode *expr) : ASTNode(lval, expr) {};
+  ASTAssign(ASTNode *lval, ASTNode *expr) : ASTNode(AST_ASSIGN, lval, expr) {};
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTFcall : public ASTNode {
 public:
-  ASTFcall(string name, ASTNode *params) : ASTNode(name, params) {};
+  Symbol id;
+  int function = -1;     // set by sem(): the number of the function
+  const int *outer = nullptr; // set by sem(): the slots of the caller to
+                         // pass for the variables the function takes
+  ASTFcall(Symbol name, ASTNode *params) : ASTNode(AST_FCALL, params), id(name) {};
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTFcall_stmt : public ASTNode {
 public:
-  ASTFcall_stmt(ASTNode *fcall) : ASTNode(fcall) {};
+  ASTFcall_stmt(ASTNode *fcall) : ASTNode(AST_FCALL_STMT, fcall) {};
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTIf : public ASTNode {
 public:
-  ASTIf(ASTNode *cond, ASTNode *ifblock) : ASTNode(cond, ifblock) {};
+  ASTIf(ASTNode *cond, ASTNode *ifblock) : ASTNode(AST_IF, cond, ifblock) {};
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTIfelse : public ASTNode {
 public:
-  ASTIfelse(ASTNode *ifnode, ASTNode *elseblock) : ASTNode(ifnode, elseblock) {};
+  ASTIfelse(ASTNode *ifnode, ASTNode *elseblock) : ASTNode(AST_IFELSE, ifnode, elseblock) {};
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTWhile : public ASTNode {
 public:
-  ASTWhile(ASTNode *cond, ASTNode *body) : ASTNode(cond, body) {};
+  ASTWhile(ASTNode *cond, ASTNode *body) : ASTNode(AST_WHILE, cond, body) {};
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTRet : public ASTNode {
 public:
-  ASTRet(ASTNode *expr) : ASTNode(expr) {};
+  ASTRet(ASTNode *expr) : ASTNode(AST_RET, expr) {};
   void sem();
   llvm::Value * codegen();
 };
 
 class ASTOp : public ASTNode {
 public:
-  ASTOp(ASTNode *left, kind op, ASTNode *right) : ASTNode(left, op, right) {};
+  ASTOp(ASTNode *left, kind op, ASTNode *right) : ASTNode(AST_OP, left, right) {
+    this->op = op;
+  };
   void sem();
   llvm::Value * codegen();
 };
 
+// forget the functions sem() was in the middle of (see resetCompiler)
+void resetSem();
+
+/* ---------------------------------------------------------------------
+   ---- --single-pass: sem() generates the code of each function as ----
+   ---- it goes, a statement right after it is checked, so that the ----
+   ---- tree is walked once; the slots of a function are filled as -----
+   ---- sem() gives them out -------------------------------------------
+   --------------------------------------------------------------------- */
+
+extern thread_local bool singlePass;   // set by compile() around sem()
+
+// in codegen.cpp; after an error they do nothing, and the module is
+// thrown away at the end
+void singlePassBegin();                    // before sem()
+void singlePassFunction(ASTFdecl *fdecl);  // header checked
+void singlePassVariable(ASTVdef *vdef);    // declared
+void singlePassStatement(ASTNode *stmt);   // checked
+void singlePassFunctionEnd();              // body checked
+void singlePassEnd();        // after sem(): optimize and emit, or nothing
+
 #endif
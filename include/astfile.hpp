@@ -0,0 +1,28 @@
+#ifndef __ASTFILE_HPP__
+#define __ASTFILE_HPP__
+
+#include "ast.hpp"
+
+/* ---------------------------------------------------------------------
+   ---- checked ASTs on disk (--emit-ast): the tree as sem() left it, --
+   ---- types and annotations included, which bin/alan takes in place --
+   ---- of a source and generates code from without lexing, parsing ---
+   ---- or checking anything again ------------------------------------
+   --------------------------------------------------------------------- */
+
+// changes whenever the layout (see astfile.cpp) or a field does
+#define AST_FORMAT_VERSION 2
+
+// write the checked tree t to path ("-" is stdout)
+void writeAST(const char *path, ASTNode *t);
+
+// is the source (see openSource) a checked AST instead of Alan?
+bool isCheckedAST();
+
+// the tree of the checked AST in the source: the nodes are built in
+// astArena, their string literals stay where they are in the source;
+// a file with indices out of bounds, or nodes without the children
+// codegen needs, is reported as corrupt (fatal)
+ASTNode *readAST();
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef __CACHE_HPP__
+#define __CACHE_HPP__
+
+#include <string>
+
+#include <llvm/ADT/StringRef.h>
+
+/* ---------------------------------------------------------------------
+   ---- the compilation cache: object files and executables, stored ----
+   ---- under a hash of everything that went into them ----------------
+   --------------------------------------------------------------------- */
+
+// key of the output of kind "o" or "exe" for the given source; the
+// executable of the compiler and the runtime library (for "exe") go in
+// by identity, so that rebuilding either one invalidates the entries
+std::string cacheKey(llvm::StringRef source, const char *kind,
+                     const std::string &compiler, const std::string &library);
+
+// copy the entry of key to output; false (a miss) if there is none
+bool cacheFetch(const std::string &key, const char *output);
+
+// keep a copy of output as the entry of key, evicting the least
+// recently used entries if the cache grows past its size limit
+void cacheStore(const std::string &key, const char *output);
+
+// key of the optimized code of one function (--incremental), given
+// the IR of the module that holds just that function
+std::string functionKey(llvm::StringRef ir);
+
+// the entry of key as data; false if there is none
+bool cacheLoad(const std::string &key, std::string &data);
+
+// store data as the entry of key; returns the bytes written (0 if none)
+long cacheSave(const std::string &key, llvm::StringRef data);
+
+// account for one compilation's function lookups and saved bytes at
+// once (evicting, as cacheStore does, if needed)
+void cacheCount(unsigned long functionHits, unsigned long functionMisses, long bytes);
+
+// --cache-stats
+void printCacheStats();
+
+#endif
@@ -2,37 +2,33 @@
 #define __CODEGEN_HPP__
 
 #include <string>
-#include <unordered_map>
 #include <vector>
 #include <typeinfo>
 
 #include "ast.hpp"
+#include "memreport.hpp"
 
 #include <llvm/IR/IRBuilder.h>
-#include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/Support/raw_ostream.h>
-#include <llvm/Transforms/Scalar.h>
-#if defined(LLVM_VERSION_MAJOR) && LLVM_VERSION_MAJOR >= 4
-#include <llvm/Transforms/Scalar/GVN.h>
-#endif
 
-extern const char* filename;
+extern thread_local const char* filename;
 
 /* ---------------------------------------------------------------------
    ---------- global LLVM variables related to the LLVM suite ----------
    --------------------------------------------------------------------- */
 
-static llvm::LLVMContext TheContext;
-static llvm::IRBuilder<> Builder(TheContext);
-static std::unique_ptr<llvm::Module> TheModule;
-static std::unique_ptr<llvm::legacy::FunctionPassManager> TheFPM;
+// in codegen.cpp, one of each per thread, so that threads can generate
+// code at once (libalan)
+extern thread_local llvm::LLVMContext TheContext;
+extern thread_local llvm::IRBuilder<> Builder;
+extern thread_local std::unique_ptr<llvm::Module> TheModule;
 
 // useful LLVM types:
-static llvm::Type * i8   = llvm::IntegerType::get(TheContext, 8);
-static llvm::Type * i32  = llvm::IntegerType::get(TheContext, 32);
-static llvm::Type * proc = llvm::Type::getVoidTy(TheContext);
+extern thread_local llvm::Type * i8;
+extern thread_local llvm::Type * i32;
+extern thread_local llvm::Type * proc;
 
 // useful LLVM helper functions...
 // ...for bytes
@@ -49,108 +45,117 @@ llvm::Type *type_to_llvm(Type type, PassMode pm);
 
 void codegen(ASTNode *t);
 
+// forget the module and the scopes codegen() (or --single-pass) was in
+// the middle of (see resetCompiler)
+void resetCodegen();
+
 
 /* ---------------------------------------------------------------------
    ------------------------------- Scopelog ----------------------------
    ---------------------------------------------------------------------
-   > variableTypes:     types of all variables
-   > variableAllocas:   addresses of the stack slots of all variables
-   > functions:         all functions
+   the frame (see ast.hpp) of a function being generated:
+   > entry:       its entry block, where the stack slots go
+   > base:        where its slots start in the table of the Logger; the
+                  slots before it are those of the functions around it
  ----------------------------------------------------------------------- */
 
 typedef struct {
-    unordered_map<string, llvm::Type*> variableTypes;
-    unordered_map<string, llvm::AllocaInst*> variableAllocas;
-    unordered_map<string, llvm::Function*> functions;
+    llvm::BasicBlock *entry;
+    size_t base;
 } scopeLog;
 
 
 /* ---------------------------------------------------------------------
    ------------- Logger: scope, variable and function info -------------
-   --------------------------------------------------------------------- */
+   ---------------------------------------------------------------------
+   the slots of all the functions being generated are in one table, the
+   frame of the innermost last; a variable that hides another takes its
+   slot in the innermost frame, which goes as a whole when the function
+   is done, so closing a scope only cuts the table back to its base.
+   The table keeps its room, so functions after the deepest one so far
+   allocate nothing
+ ----------------------------------------------------------------------- */
 
 class Logger {
 private:
-    vector<scopeLog> scopeLogs;
-public:
-    Logger() {
-        this->openScope();
+    vector<scopeLog> scopeLogs;          // innermost last
+    vector<llvm::AllocaInst*> variables; // the stack slots of the variables
+    vector<Symbol> names;                // their names, to name the
+                                         // parameters of nested functions
+    vector<llvm::Function*> functions;   // by number (see ast.hpp)
+
+    // the index in the table of a slot of the current frame
+    size_t index(int slot) {
+        size_t i = this->scopeLogs.back().base + slot;
+        // if sem was ok, this should not happen
+        if (slot < 0 || i >= this->variables.size())
+            internal("Variable in slot %d not in scope.", slot);
+        return i;
     };
-    
-    // create and push new scopelog
-    void openScope() {
-        scopeLog sl;
-        this->scopeLogs.push_back(sl);
+public:
+    // push the scopelog of a function, with no slots yet
+    void openScope(llvm::BasicBlock *entry) {
+        MemScope scope(MEM_LOGGER);
+        this->scopeLogs.push_back({ entry, this->variables.size() });
     };
-    
-    // pop scopelog
+
+    // pop scopelog, and its slots with it
     void closeScope() {
+        size_t base = this->scopeLogs.back().base;
+        this->variables.resize(base);
+        this->names.resize(base);
         this->scopeLogs.pop_back();
     };
 
-    // add a variable to current scopelog
-    void addVariable(string id, llvm::Type *type, llvm::AllocaInst *alloca) {
-        this->scopeLogs.back().variableTypes[id] = type;
-        this->scopeLogs.back().variableAllocas[id] = alloca;
+    // true if no function is being generated
+    bool empty() {
+        return this->scopeLogs.empty();
     };
 
-    // lookup variable by id and return type
-    llvm::Type * getVarType(string id) {
-        for (auto it = this->scopeLogs.rbegin(); it != this->scopeLogs.rend(); ++it) {
-            if (!(it->variableTypes.find(id) == it->variableTypes.end()))
-                return it->variableTypes[id];
-        }
-        // if sem was ok, this point should be unreachable
-        internal("Variable \"%s\" not in scope.", id);
-        return nullptr;
+    // getter: the entry block of the current function
+    llvm::BasicBlock * getEntry() {
+        return this->scopeLogs.back().entry;
     };
 
-    // lookup variable by id and return address of stack slot
-    llvm::AllocaInst * getVarAlloca(string id) {
-        for (auto it = this->scopeLogs.rbegin(); it != this->scopeLogs.rend(); ++it) {
-            if (!(it->variableAllocas.find(id) == it->variableAllocas.end()))
-                return it->variableAllocas[id];
+    // put a variable in its slot of the current frame: the next one, or
+    // that of the variable it hides
+    void addVariable(int slot, Symbol id, llvm::AllocaInst *alloca) {
+        MemScope scope(MEM_LOGGER);
+        size_t i = this->scopeLogs.back().base + slot;
+        if (slot < 0 || i > this->variables.size())
+            internal("Variable \"%s\" has no slot.", id->text);
+        if (i == this->variables.size()) {
+            this->variables.push_back(alloca);
+            this->names.push_back(id);
         }
-        // if sem was ok, this point should be unreachable
-        internal("Variable \"%s\" not in scope.", id);
-        return nullptr;
-    };
-
-    // lookup variable by id and return true if it is a pointer and false otherwise
-    bool isPointer(string id) {
-        for (auto it = this->scopeLogs.rbegin(); it != this->scopeLogs.rend(); ++it) {
-            if (!(it->variableTypes.find(id) == it->variableTypes.end()))
-                return it->variableTypes[id]->isPointerTy();
+        else {
+            this->variables[i] = alloca;
+            this->names[i] = id;
         }
-        // if sem was ok, this point should be unreachable
-        internal("Variable \"%s\" not in scope.", id);
-        return false;
     };
 
-    // add function to scopelog
-    void addFunctionInScope(string fname, llvm::Function *F) {
-    		this->scopeLogs.back().functions[fname] = F;
+    // the address of the stack slot of the variable in a slot
+    llvm::AllocaInst * getVarAlloca(int slot) {
+        return this->variables[this->index(slot)];
     };
 
-    // lookup function by id
-    llvm::Function * getFunctionInScope(string id) {
-        for (auto it = this->scopeLogs.rbegin(); it != this->scopeLogs.rend(); ++it) {
-            if (!(it->functions.find(id) == it->functions.end()))
-                return it->functions[id];
-        }
-        // if sem was ok, this point should be unreachable
-        internal("Function \"%s\" not in scope.", id);
-        return nullptr;
+    // the name of the variable in a slot
+    Symbol getVarName(int slot) {
+        return this->names[this->index(slot)];
     };
 
-    // getter
-    unordered_map<string, llvm::Type*> getCurrentScopeVarTypes() {
-        return this->scopeLogs.back().variableTypes;
+    // add function, the next by number
+    void addFunction(llvm::Function *F) {
+        MemScope scope(MEM_LOGGER);
+        this->functions.push_back(F);
     };
 
-    // getter
-    unordered_map<string, llvm::AllocaInst*> getCurrentScopeVarAllocas() {
-        return this->scopeLogs.back().variableAllocas;
+    // lookup function by number
+    llvm::Function * getFunction(int n) {
+        // if sem was ok, this should not happen
+        if (n < 0 || (size_t) n >= this->functions.size())
+            internal("Function %d not in scope.", n);
+        return this->functions[n];
     };
 };
 
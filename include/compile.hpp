@@ -0,0 +1,17 @@
+#ifndef __COMPILE_HPP__
+#define __COMPILE_HPP__
+
+// set up the symbol table with the library functions ahead of compile()
+// (the compile server does it once, before forking its workers)
+void prepareCompiler();
+
+// parse, check and codegen the source (see openSource), writing the
+// outputs requested in options; returns non zero if it was rejected
+int compile();
+
+// put the compiler back the way it was before compile(), even one cut
+// short by a fatal error (see fatalReturn), so that the thread can
+// compile again (libalan)
+void resetCompiler();
+
+#endif
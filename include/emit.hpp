@@ -0,0 +1,36 @@
+#ifndef __EMIT_HPP__
+#define __EMIT_HPP__
+
+#include <string>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+// register the native target with LLVM (done by targetMachine too);
+// only the first call does anything, whatever the thread
+void initTargets();
+
+// the outputs of emit(), kept in memory instead of written (libalan)
+typedef struct {
+  std::string ll, bc, assembly, object;
+} EmitBuffers;
+
+// if set, emit() fills it in place of the files named in options (which
+// then only say which outputs are wanted)
+extern thread_local EmitBuffers *emitBuffers;
+
+// the "native" features of the host, in the +feature,-feature form of
+// -mattr, sorted (the cache keys on them)
+std::string hostFeatures();
+
+// create a target machine for the host (honouring -mcpu and -mattr)
+// and set the triple and data layout of M to match it
+llvm::TargetMachine *targetMachine(llvm::Module &M);
+
+// write every output requested on the command line (IR, bitcode,
+// assembly, object) with at most one run of the backend; if obj is
+// given, the object code is also left there (for --run)
+void emit(llvm::Module &M, llvm::TargetMachine *TM, llvm::SmallVectorImpl<char> *obj = nullptr);
+
+#endif
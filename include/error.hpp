@@ -22,6 +22,8 @@
 #ifndef __ERROR_HPP__
 #define __ERROR_HPP__
 
+#include <setjmp.h>
+
 /* ---------------------------------------------------------------------
    ---------       ----------
    --------------------------------------------------------------------- */
@@ -31,6 +33,23 @@ void fatal    (const char * fmt, ...);
 void error    (const char * fmt, ...);
 void warning  (const char * fmt, ...);
 
-extern const char *filename;
+extern thread_local const char *filename;
+
+/* ---------------------------------------------------------------------
+   ---- libalan: diagnostics handed over as data, and fatal errors -----
+   ---- that return to the caller instead of ending the process --------
+   --------------------------------------------------------------------- */
+
+typedef enum { DIAG_WARNING, DIAG_ERROR, DIAG_FATAL, DIAG_INTERNAL } DiagKind;
+
+/* if set, diagnostics go there instead of to stderr: line is 0 for
+   those that are not about a line, message has no colours, no newline */
+extern thread_local void (*diagnosticSink)(DiagKind kind, int line, const char * message);
+
+/* if set, fatal() and internal() longjmp() there instead of exiting
+   (LLVM is built without exceptions); what the compiler was doing is
+   left for resetCompiler() to clean up; syntax and lexical errors are
+   errors, not fatal ones, so parsing never jumps out */
+extern thread_local jmp_buf * fatalReturn;
 
 #endif
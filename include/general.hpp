@@ -24,18 +24,20 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <string>
 #include "error.hpp"
 
 void * mynew        (size_t size);
 void   mydelete     (void * p);
+char * mystrdup     (const char * s);
 char   escapeChar   (char *s);
-char * escapeString (char *s);
+std::string escapeString (const char *s, int length);
 
 /* ---------------------------------------------------------------------
    --------------     ---------------
    --------------------------------------------------------------------- */
 
-extern int linecount;
-extern int sem_failed;
+extern thread_local int linecount;
+extern thread_local int sem_failed;
 
 #endif
@@ -0,0 +1,26 @@
+#ifndef __INTERN_HPP__
+#define __INTERN_HPP__
+
+/* ---------------------------------------------------------------------
+   ---- interned names: the lexer turns every identifier into a -------
+   ---- Symbol, one per distinct name, so that the symbol table and ----
+   ---- codegen compare and hash pointers instead of strings -----------
+   --------------------------------------------------------------------- */
+
+typedef struct {
+  const char *text;     // NUL-terminated, freed only by forgetNames()
+  int length;
+  unsigned hash;        // of the text, for the tables that need one
+} SymbolName;
+
+typedef const SymbolName *Symbol;
+
+// the Symbol of text[0..length); the same one every time
+Symbol intern(const char *text, int length);
+Symbol intern(const char *text);
+
+// free every name interned so far (libalan, between compilations of
+// a thread, so that it does not keep the names of all of them)
+void forgetNames();
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef __JIT_HPP__
+#define __JIT_HPP__
+
+#include <llvm/ADT/StringRef.h>
+
+// link the object code of a program in memory against the runtime
+// library built into bin/alan and call its main; does not return, but
+// exits with the status main returns (as the executable would)
+void run(llvm::StringRef obj);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef __MEMREPORT_HPP__
+#define __MEMREPORT_HPP__
+
+#include <stddef.h>
+
+/* ---------------------------------------------------------------------
+   ---- --mem-report: peak RSS of each phase and what was allocated ----
+   ---- in it, by each subsystem of the compiler, printed at exit ------
+   --------------------------------------------------------------------- */
+
+typedef enum {
+  PHASE_DRIVER,      // options, LLVM start-up, linking: everything else
+  PHASE_PARSE,
+  PHASE_SEM,
+  PHASE_CODEGEN,
+  PHASE_OPTIMIZE,
+  PHASE_EMIT,
+  PHASE_RUN,
+  PHASE_COUNT
+} MemPhase;
+
+typedef enum {
+  MEM_AST,           // nodes and the strings of the lexer
+  MEM_SYMBOLS,       // symbol table entries and scopes
+  MEM_TYPES,         // array and pointer types of the symbol table
+  MEM_LOGGER,        // scope logs of codegen
+  MEM_LLVM,          // the module and everything LLVM makes of it
+  MEM_OTHER,
+  MEM_COUNT
+} MemSubsystem;
+
+extern bool memReporting;
+
+// start counting; the report goes to stderr when the compiler exits
+void memReportStart();
+
+// count an allocation: mynew() and arenas call it, and so does the
+// operator new of bin/alan (memhook.cpp; libalan has none)
+void memCount(size_t bytes);
+
+// enter phase p; returns the phase that was left
+MemPhase memPhase(MemPhase p);
+
+// the subsystem that allocations are charged to; returns the old one
+MemSubsystem memSubsystem(MemSubsystem s);
+
+// a phase that lasts as long as the scope it is declared in
+class MemPhaseScope {
+private:
+  MemPhase outer;
+public:
+  MemPhaseScope(MemPhase p) : outer(PHASE_DRIVER) {
+    if (memReporting) outer = memPhase(p);
+  };
+  ~MemPhaseScope() {
+    if (memReporting) memPhase(outer);
+  };
+};
+
+// allocations made in the scope are charged to subsystem s
+class MemScope {
+private:
+  MemSubsystem outer;
+public:
+  MemScope(MemSubsystem s) : outer(MEM_OTHER) {
+    if (memReporting) outer = memSubsystem(s);
+  };
+  ~MemScope() {
+    if (memReporting) memSubsystem(outer);
+  };
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef __OPTIMIZE_HPP__
+#define __OPTIMIZE_HPP__
+
+#include "options.hpp"
+
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+// run the (new PassManager) optimization pipeline of the given level on M,
+// tuned for the target of TM
+void optimize(llvm::Module &M, OptLevel level, llvm::TargetMachine *TM);
+
+// the same, one function at a time (so without inlining across them),
+// keeping the optimized functions in the compilation cache: functions
+// that did not change since they were last compiled are not optimized
+void optimizeIncrementally(llvm::Module &M, OptLevel level, llvm::TargetMachine *TM);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef __OPTIONS_HPP__
+#define __OPTIONS_HPP__
+
+/* ---------------------------------------------------------------------
+   ------------------ command line options of bin/alan -----------------
+   --------------------------------------------------------------------- */
+
+typedef enum {
+  OPT_O0, OPT_O1, OPT_O2, OPT_O3, // speed
+  OPT_Os, OPT_Oz                  // size
+} OptLevel;
+
+typedef struct {
+  const char *infile;   // Alan source (NULL is stdin)
+  const char **infiles; // all of them, when more than one is given
+  int numInfiles;
+  int jobs;             // -j: compile that many infiles at once
+  const char *outName;  // -o: the produced executable
+  bool dumpIR;          // -i: print IR to stdout, no executable
+  bool dumpFinal;       // -f: print assembly to stdout, no executable
+  bool noLink;          // -c: stop at the object file
+  bool saveTemps;       // keep IR and assembly in <progname>.imm/.asm
+  bool run;             // --run: JIT and execute the program, no executable
+  bool cache;           // --cache: reuse objects and executables built before
+  bool incremental;     // --incremental: optimize (and cache) per function
+  bool singlePass;      // --single-pass: generate code while checking
+  const char *timeTrace; // -ftime-trace[=file] ("" is <progname>.json)
+  bool memReport;       // --mem-report: peak RSS and allocations per phase
+  bool symbolStats;     // --symbol-stats: load and probes of the symbol table
+  OptLevel optLevel;    // optimization pipeline to run on the module
+  bool printPasses;     // list every pass of the pipeline as it runs
+  const char *emitLl;   // output files ("-" is stdout, NULL is none)...
+  const char *emitBc;   // ...for LLVM IR, bitcode,
+  const char *emitAsm;  // assembly
+  const char *emitObj;  // and object code
+  const char *emitAst;  // --emit-ast: the checked AST, to compile later
+  const char *cpu;      // -mcpu (NULL is generic)
+  const char *features; // -mattr (NULL is none)
+} Options;
+
+extern thread_local Options options;
+
+void parseOptions(int argc, char *argv[]);
+
+// program name: infile without its directory and .alan (or .ast) suffix
+const char *programName(const char *infile);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef __PROTOCOL_HPP__
+#define __PROTOCOL_HPP__
+
+#include <stdint.h>
+#include <sys/un.h>
+#include <string>
+#include <vector>
+
+/* ---------------------------------------------------------------------
+   ------------- wire format between alan --server and clients ---------
+   -- request:  u32 size, then the strings of argv, environ and the cwd,
+   --           each list as u32 count + (u32 length, bytes) per string;
+   --           the client's fds 0, 1 and 2 travel with the first byte
+   -- reply:    i32 exit status of the compilation
+   -- (no LLVM in here: bin/alan-connect is built from this alone)
+   --------------------------------------------------------------------- */
+
+const int passedFds = 3;
+
+void putStrings(std::string &msg, int n, char *strings[]);
+// read the next list of strings of msg at *pos; false if msg is short
+bool getStrings(const std::string &msg, size_t *pos, std::vector<std::string> &strings);
+
+bool writeAll(int fd, const void *buf, size_t n);
+bool readAll(int fd, void *buf, size_t n);
+
+// false if path does not fit in a sockaddr_un
+bool socketAddress(const char *path, struct sockaddr_un *addr);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef __SERVER_HPP__
+#define __SERVER_HPP__
+
+/* ---------------------------------------------------------------------
+   ------------ the compile server: alan --server / --connect ----------
+   --------------------------------------------------------------------- */
+
+// one compilation, as bin/alan does it: command line in, exit status out
+typedef int (*Job)(int argc, char *argv[]);
+
+// accept requests on the Unix socket path forever; every request runs
+// job in a fork of this warm process, with the stdin, stdout, stderr,
+// working directory and environment of the client
+int serve(const char *path, Job job);
+
+// send the command line argv to the server at path and wait for it;
+// returns the exit status of the compilation, or -1 (and errno) if
+// the server cannot be reached
+int request(const char *path, int argc, char *argv[]);
+
+#endif
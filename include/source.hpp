@@ -0,0 +1,34 @@
+#ifndef __SOURCE_HPP__
+#define __SOURCE_HPP__
+
+#include <stddef.h>
+#include <string>
+
+/* ---------------------------------------------------------------------
+   ------ the Alan source, mapped into memory once; tokens refer to ----
+   ------ spans of it instead of copies --------------------------------
+   --------------------------------------------------------------------- */
+
+// a piece of the source (not NUL-terminated)
+typedef struct {
+  const char *text;
+  int length;
+
+  std::string str() const { return std::string(text, length); };
+} Span;
+
+// NUL bytes after the end of the source: flex wants two of them at the
+// end of a buffer it scans in place, the scanner reads whole vectors
+#define SOURCE_PADDING 64
+
+// the source and its length (followed by SOURCE_PADDING NULs)
+extern thread_local char *sourceText;
+extern thread_local size_t sourceLength;
+
+// map infile (NULL is stdin, which is read instead)
+void openSource(const char *infile);
+
+// have the lexer scan the source (scanner.cpp, or lexer.l)
+void scanSource();
+
+#endif
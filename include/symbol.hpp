@@ -29,6 +29,9 @@
 
 #include <stdbool.h>
 
+#include "arena.hpp"
+#include "intern.hpp"
+
 /*
  *     include     
  *   C  ,     :
@@ -79,7 +82,7 @@ struct Type_tag {
     kind_t kind;
     Type           refType;              /*              */
     RepInteger     size;                 /* ,    */
-    unsigned int   refCount;             /*           */
+    unsigned int   hash;                 /* For hash-consing          */
 };
 
 
@@ -116,8 +119,11 @@ struct SymbolEntry_tag {
    EntryType      entryType;          /*               */
    unsigned int   nestingLevel;       /*               */
    unsigned int   hashValue;          /*            */
-   SymbolEntry  * nextHash;           /*    ..     */
+   SymbolEntry  * nextHash;           /* Same name, an outer scope     */
    SymbolEntry  * nextInScope;        /*     */
+   int            slot;               /* Variable, parameter: its slot
+                                         in the function being checked;
+                                         function: its number (codegen) */
 
    union {                            /*     : */
 
@@ -172,9 +178,23 @@ struct Scope_tag {
     unsigned int   negOffset;                /*   offset */
     Scope        * parent;                   /*    */
     SymbolEntry  * entries;                  /*     */
+    Arena::Mark    mark;                     /* Arena mark, before it  */
+    Arena::Mark    parameterMark;            /* After its parameters   */
 };
 
 
+/* How the hash table has done so far (--symbol-stats) */
+
+typedef struct {
+    unsigned int   slots;                    /* Now                    */
+    unsigned int   names;                    /* Slots taken, now       */
+    unsigned long  searches;                 /* Of a name's slot       */
+    unsigned long  probes;                   /* Slots looked at        */
+    unsigned int   longestProbe;             /* By one search          */
+    unsigned int   grows;                    /* Doublings              */
+} SymbolTableStats;
+
+
 /*      */
 
 typedef enum {
@@ -187,9 +207,9 @@ typedef enum {
    -------------      --------------
    --------------------------------------------------------------------- */
 
-extern Scope        * currentScope;       /*           */
-extern unsigned int   quadNext;           /*    */
-extern unsigned int   tempNumber;         /*   temporaries  */
+extern thread_local Scope        * currentScope;       /*           */
+extern thread_local unsigned int   quadNext;           /*    */
+extern thread_local unsigned int   tempNumber;         /*   temporaries  */
 
 extern const Type typeVoid;
 extern const Type typeInteger;
@@ -204,27 +224,27 @@ extern const Type typeReal;
 
 void          initSymbolTable    (unsigned int size);
 void          destroySymbolTable (void);
+SymbolTableStats symbolTableStats (void);
 
 void          openScope          (void);
 void          closeScope         (void);
 
-SymbolEntry * newVariable        (const char * name, Type type);
-SymbolEntry * newConstant        (const char * name, Type type, ...);
-SymbolEntry * newFunction        (const char * name);
-SymbolEntry * newParameter       (const char * name, Type type,
+SymbolEntry * newVariable        (Symbol name, Type type);
+SymbolEntry * newConstant        (Symbol name, Type type, ...);
+SymbolEntry * newFunction        (Symbol name);
+SymbolEntry * newParameter       (Symbol name, Type type,
                                   PassMode mode, SymbolEntry * f);
 SymbolEntry * newTemporary       (Type type);
 
 void          forwardFunction    (SymbolEntry * f);
 void          endFunctionHeader  (SymbolEntry * f, Type type);
-void          destroyEntry       (SymbolEntry * e);
-SymbolEntry * lookupEntry        (const char * name, LookupType type,
+SymbolEntry * lookupEntry        (Symbol name, LookupType type,
                                   bool err);
 
 Type          typeArray          (RepInteger size, Type refType);
 Type          typeIArray         (Type refType);
 Type          typePointer        (Type refType);
-void          destroyType        (Type type);
+void          forgetTypes        (void);
 unsigned int  sizeOfType         (Type type);
 bool          equalType          (Type type1, Type type2);
 void          printType          (Type type);
@@ -0,0 +1,39 @@
+#ifndef __TRACE_HPP__
+#define __TRACE_HPP__
+
+#include <string>
+
+/* ---------------------------------------------------------------------
+   ----- -ftime-trace: compile time spans, written in the trace event --
+   ----- format of Chrome (chrome://tracing, Perfetto) at exit, with ----
+   ----- a summary on stderr -------------------------------------------
+   --------------------------------------------------------------------- */
+
+extern bool tracing;
+
+// start recording; the trace goes to path when the compiler exits
+void traceStart(const char *path);
+
+// open and close a span (spans nest, as calls do)
+void traceBegin(const std::string &name, const std::string &detail = "");
+void traceEnd();
+
+// time spent in name in many small pieces (e.g. lexing, which
+// interleaves with parsing): summed up and reported as one total
+void traceAdd(const char *name, long long nanoseconds);
+
+// nanoseconds on a monotonic clock
+long long traceNow();
+
+// a span that lasts as long as the scope it is declared in
+class TraceScope {
+public:
+  TraceScope(const std::string &name, const std::string &detail = "") {
+    if (tracing) traceBegin(name, detail);
+  };
+  ~TraceScope() {
+    if (tracing) traceEnd();
+  };
+};
+
+#endif
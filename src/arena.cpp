@@ -0,0 +1,64 @@
+#include <string.h>
+
+#include "arena.hpp"
+#include "general.hpp"
+#include "memreport.hpp"
+
+thread_local Arena astArena;
+
+static const size_t FIRST_CHUNK = 64 << 10, LAST_CHUNK = 1 << 20;
+
+void *Arena::grow(size_t size) {
+  Chunk *c;
+  // a scope that keeps opening and closing over the end of a chunk
+  // does not malloc() and free() one every time
+  if (spare != nullptr && spare->size >= size) {
+    c = spare;
+    spare = nullptr;
+  }
+  else {
+    chunkSize = chunkSize == 0 ? FIRST_CHUNK : chunkSize < LAST_CHUNK ? 2 * chunkSize : chunkSize;
+    MemScope scope(subsystem);
+    c = (Chunk *) mynew(sizeof(Chunk) + (size > chunkSize ? size : chunkSize));
+    c->size = size > chunkSize ? size : chunkSize;
+  }
+  c->next = chunks;
+  chunks = c;
+  next = (char *) (c + 1) + size;
+  left = c->size - size;
+  return c + 1;
+}
+
+char *Arena::copy(const char *text, int length) {
+  char *s = (char *) allocate(length + 1);
+  memcpy(s, text, length);
+  s[length] = '\0';
+  return s;
+}
+
+void Arena::rewind(const Mark &m) {
+  while (chunks != m.chunk) {
+    Chunk *c = chunks;
+    chunks = c->next;
+    if (spare == nullptr || c->size > spare->size) {
+      Chunk *smaller = spare;
+      spare = c;
+      c = smaller;
+    }
+    if (c != nullptr) mydelete(c);
+  }
+  next = m.next;
+  left = m.left;
+}
+
+void Arena::release() {
+  while (chunks != nullptr) {
+    Chunk *c = chunks;
+    chunks = c->next;
+    mydelete(c);
+  }
+  if (spare != nullptr) mydelete(spare);
+  spare = nullptr;
+  next = nullptr;
+  left = chunkSize = 0;
+}
@@ -3,14 +3,15 @@
 #include "symbol.hpp"
 #include "ast.hpp"
 #include <stack>
+#include <vector>
 
 using namespace std;
 
 // some globals to keep track of functions
-stack<SymbolEntry *> funcList;
-SymbolEntry *currFunction;
+thread_local stack<SymbolEntry *> funcList;
+thread_local SymbolEntry *currFunction;
 // flags used to define if there is a return instruction in non-proc function
-int notInCond, funcRet;
+thread_local int notInCond, funcRet;
 
 // function that calls error() if types l and r are not the same or not supported by operator op
 void checkTypes(Type l, Type r, const char *op) {
@@ -20,15 +21,203 @@ void checkTypes(Type l, Type r, const char *op) {
     error("only int and byte types supported by %s operator", op);
 }
 
+// the frames (see ast.hpp) of the functions being checked, innermost
+// last: the entries in their slots, with the names they have there,
+// and the slots the entries taken from the enclosing function had in
+// it, to be given back; SymbolEntry::slot is the slot of an entry in
+// the innermost frame that has it
+typedef struct {
+  vector<pair<SymbolEntry *, Symbol>> slots;
+  vector<pair<SymbolEntry *, int>> outer;
+  unsigned int serial;   // one for each function checked
+} Frame;
+
+// the first depth of them are in use; the rest are kept, so that their
+// vectors are reused by the next functions
+static thread_local vector<Frame> frames;
+static thread_local size_t depth;
+static thread_local unsigned int frameSerial;
+
+// what is known of each function, by its number: the names of the
+// variables it takes, which a call passes what they are at, and what
+// the calls in the body of the last function to call it passed (the
+// same for all of them)
+typedef struct {
+  const Symbol *names;
+  int count;
+  unsigned int caller;   // serial of the frame of that function
+  const int *passed;
+} Taken;
+
+static thread_local vector<Taken> taken;
+
+void resetSem() {
+  funcList = stack<SymbolEntry *>();
+  currFunction = NULL;
+  frames.clear();
+  depth = 0;
+  frameSerial = 0;
+  taken.clear();
+}
+
 // function that looks up and returns SymbolEntry named id (in any scope)
-SymbolEntry * lookup(string id) {
-  return lookupEntry(id.c_str(), LOOKUP_ALL_SCOPES, true);
+SymbolEntry * lookup(Symbol id) {
+  return lookupEntry(id, LOOKUP_ALL_SCOPES, true);
+}
+
+// the slot of the variable named id, in the frame of the function being
+// checked; functions do not hide variables there (-1 if there is none)
+static int variableSlot(Symbol id) {
+  for (SymbolEntry *e = lookupEntry(id, LOOKUP_ALL_SCOPES, false); e != NULL; e = e->nextHash)
+    if (e->entryType != ENTRY_FUNCTION)
+      return e->slot;
+  return -1;
+}
+
+// a list of slots (see ast.hpp), in astArena with the tree; those of
+// no slots are all this one
+static const int noSlots[1] = { 0 };
+
+static int * slotList(size_t count) {
+  int *list = (int *) astArena.allocate((count + 1) * sizeof(int));
+  list[0] = count;
+  return list;
+}
+
+// the frame of the function being checked
+static Frame & currentFrame() {
+  return frames[depth - 1];
+}
+
+// a new function: an empty frame
+static void openFrame() {
+  if (depth == frames.size()) frames.push_back(Frame());
+  Frame &frame = frames[depth++];
+  frame.slots.clear();
+  frame.outer.clear();
+  frame.serial = ++frameSerial;
+}
+
+// put e, named id, in the next slot of the frame
+static void addSlot(SymbolEntry *e, Symbol id) {
+  Frame &frame = currentFrame();
+  e->slot = frame.slots.size();
+  frame.slots.push_back({ e, id });
+}
+
+// after the parameters of function f: the variables of the enclosing
+// function that it takes, all those its parameters do not hide
+static void takeOuter(ASTFdecl *fdecl, SymbolEntry *f) {
+  Frame &frame = currentFrame();
+  size_t own = frame.slots.size();
+  if (depth > 1) {
+    Frame &enclosing = frames[depth - 2];
+    for (size_t i = 0; i < enclosing.slots.size(); i++) {
+      SymbolEntry *var = enclosing.slots[i].first;
+      Symbol name = enclosing.slots[i].second;
+      size_t p = 0;
+      while (p < own && frame.slots[p].second != name) p++;
+      if (p < own) continue;
+      frame.outer.push_back({ var, var->slot });
+      addSlot(var, name);
+    }
+  }
+  size_t count = frame.slots.size() - own;
+  if ((size_t) f->slot >= taken.size()) taken.resize(f->slot + 1);
+  if (count == 0) {
+    fdecl->outer = noSlots;
+    taken[f->slot] = { NULL, 0, 0, NULL };
+    return;
+  }
+  int *outer = slotList(count);
+  Symbol *names = (Symbol *) astArena.allocate(count * sizeof(Symbol));
+  for (size_t i = 0; i < count; i++) {
+    outer[i + 1] = frame.outer[i].second;
+    names[i] = frame.slots[own + i].second;
+  }
+  fdecl->outer = outer;
+  taken[f->slot] = { names, (int) count, 0, NULL };
+}
+
+// a variable of the function: one that hides a variable the function
+// took takes its slot
+static void addVariable(SymbolEntry *v, Symbol id) {
+  Frame &frame = currentFrame();
+  for (SymbolEntry *e = v->nextHash; e != NULL; e = e->nextHash)
+    if (e->entryType != ENTRY_FUNCTION) {
+      if (e->slot >= 0 && (size_t) e->slot < frame.slots.size() && frame.slots[e->slot].first == e) {
+        v->slot = e->slot;
+        frame.slots[v->slot] = { v, id };
+        return;
+      }
+      break;
+    }
+  addSlot(v, id);
+}
+
+// the function is checked: give the entries it took their slots back
+static void closeFrame() {
+  for (auto &outer : currentFrame().outer) outer.first->slot = outer.second;
+  depth--;
+}
+
+// what a call in the function being checked passes to function for the
+// variables it takes: the variables their names are here
+static const int * passedSlots(int function) {
+  if ((size_t) function >= taken.size()) taken.resize(function + 1);
+  Taken &t = taken[function];
+  if (t.count == 0) return noSlots;
+  unsigned int caller = currentFrame().serial;
+  if (t.caller != caller) {
+    int *passed = slotList(t.count);
+    for (int i = 0; i < t.count; i++) passed[i + 1] = variableSlot(t.names[i]);
+    t.caller = caller;
+    t.passed = passed;
+  }
+  return t.passed;
 }
 
 /* ---------------------------------------------------------------------
    ------------------ sem() method: semantic analysis ------------------
    --------------------------------------------------------------------- */
 
+// the name of whatever class this node is
+Symbol ASTNode::name() {
+  switch (nodeKind) {
+    case AST_ID:     return static_cast<ASTId *>(this)->id;
+    case AST_FCALL:  return static_cast<ASTFcall *>(this)->id;
+    case AST_VDEF:   return static_cast<ASTVdef *>(this)->id;
+    case AST_FDECL:  return static_cast<ASTFdecl *>(this)->id;
+    case AST_PAR:    return static_cast<ASTPar *>(this)->id;
+    case AST_STRING: return static_cast<ASTString *>(this)->id;
+    case AST_CHAR:   return intern(&static_cast<ASTChar *>(this)->c, 1);
+    default:         return nullptr;
+  }
+}
+
+// semantic analysis of whatever class this node is
+void ASTNode::sem() {
+  switch (nodeKind) {
+    case AST_ID:         static_cast<ASTId *>(this)->sem(); return;
+    case AST_INT:        static_cast<ASTInt *>(this)->sem(); return;
+    case AST_CHAR:       static_cast<ASTChar *>(this)->sem(); return;
+    case AST_STRING:     static_cast<ASTString *>(this)->sem(); return;
+    case AST_VDEF:       static_cast<ASTVdef *>(this)->sem(); return;
+    case AST_SEQ:        static_cast<ASTSeq *>(this)->sem(); return;
+    case AST_FDEF:       static_cast<ASTFdef *>(this)->sem(); return;
+    case AST_FDECL:      static_cast<ASTFdecl *>(this)->sem(); return;
+    case AST_PAR:        static_cast<ASTPar *>(this)->sem(); return;
+    case AST_ASSIGN:     static_cast<ASTAssign *>(this)->sem(); return;
+    case AST_FCALL:      static_cast<ASTFcall *>(this)->sem(); return;
+    case AST_FCALL_STMT: static_cast<ASTFcall_stmt *>(this)->sem(); return;
+    case AST_IF:         static_cast<ASTIf *>(this)->sem(); return;
+    case AST_IFELSE:     static_cast<ASTIfelse *>(this)->sem(); return;
+    case AST_WHILE:      static_cast<ASTWhile *>(this)->sem(); return;
+    case AST_RET:        static_cast<ASTRet *>(this)->sem(); return;
+    case AST_OP:         static_cast<ASTOp *>(this)->sem(); return;
+  }
+}
+
 // semantic analysis of ASTId Node
 void ASTId::sem() {
 	linecount = line;
@@ -76,8 +265,7 @@ void ASTId::sem() {
     default:
     internal("garbage in symbol table");
   }
-  nesting_diff = currentScope->nestingLevel - e->nestingLevel;
-  offset = e->u.eVariable.offset;
+  slot = e->entryType != ENTRY_FUNCTION ? e->slot : variableSlot(id);
   return;
 }
 
@@ -98,7 +286,14 @@ void ASTChar::sem() {
 // semantic analysis of ASTString Node
 void ASTString::sem() {
 	linecount = line;
-  type = typeArray(id.length(), typeChar);
+  // decoded into astArena, not interned: it names nothing
+  string s = escapeString(literal.text, literal.length);
+  SymbolName *decoded = (SymbolName *) astArena.allocate(sizeof(SymbolName));
+  decoded->text = astArena.copy(s.c_str(), s.size());
+  decoded->length = s.size();
+  decoded->hash = 0;
+  id = decoded;
+  type = typeArray(id->length, typeChar);
   return;
 }
 
@@ -107,7 +302,11 @@ void ASTVdef::sem() {
 	linecount = line;
   if (type->kind == TYPE_ARRAY && type->size <= 0)
     error("illegal size of array in variable definition");
-  newVariable(id.c_str(), type);							// create new variable
+  SymbolEntry *v = newVariable(id, type);		// create new variable
+  if (!v) return;
+  addVariable(v, id);
+  slot = v->slot;
+  if (singlePass) singlePassVariable(this);
   return;
 }
 
@@ -120,28 +319,41 @@ void ASTFdef::sem() {
     funcRet = 1;                              // --> no ret instr needed
   else                                        // for non-proc functions:
     funcRet = 0;                              // --> initialize funcRet = 0 (no ret instr found in function main body)
-  if (right) right->sem();										// semantic analysis of function body (compound statement) if any
+  if (right && singlePass)										// --single-pass: each statement of the body
+    for (ASTNode *seq = right; seq; seq = seq->right) {	// is checked, then its code generated
+      linecount = seq->line;
+      if (seq->left) {
+        seq->left->sem();
+        singlePassStatement(seq->left);
+      }
+    }
+  else if (right) right->sem();								// semantic analysis of function body (compound statement) if any
+  if (singlePass) singlePassFunctionEnd();		// the function is complete (before its scope goes)
+  closeFrame();
   closeScope();																// close function scope (after body)
   funcList.pop();															// pop from funcList
   // update currFunction:
   if (funcList.empty()) currFunction = NULL;  // for main() function
   else currFunction = funcList.top();         // for other functions
   if (!funcRet)                               // warning if no ret instr was found (outside conditional stmt)
-    warning(("Control may reach end of non-proc function " + left->id).c_str());
+    warning((string("Control may reach end of non-proc function ") + left->name()->text).c_str());
   return;
 }
 
 // semantic analysis of ASTFdecl Node
 void ASTFdecl::sem() {
 	linecount = line;
-  currFunction = newFunction(id.c_str());			// make this currFunction
+  currFunction = newFunction(id);			// make this currFunction
   openScope();																// open function scope (before parameter and local def semantic analysis)
+  openFrame();																// and its frame
   funcList.push(currFunction);								// push into funcList
   // in case of error in function declaration:
   if (!currFunction)
     return;
   if (left) left->sem();											// semantic analysis of parameters (if any)
   endFunctionHeader(currFunction, type);
+  takeOuter(this, currFunction);
+  if (singlePass) singlePassFunction(this);		// the function and the slots of its parameters
   if (right) right->sem();										// semantic analysis of local definitions (if any)
   num_vars = currentScope->negOffset;
   return;
@@ -151,13 +363,10 @@ void ASTFdecl::sem() {
 void ASTPar::sem() {
 	linecount = line;
 	// create new parameter after checking passmode)
-  if (pm == PASS_BY_VALUE) {
-    if (type->kind == TYPE_ARRAY || type->kind == TYPE_IARRAY)
-      error("an array can not be passed by value as a parameter to a function");
-    newParameter(id.c_str(), type, PASS_BY_VALUE, currFunction);
-  }
-  else
-    newParameter(id.c_str(), type, PASS_BY_REFERENCE, currFunction);
+  if (pm == PASS_BY_VALUE && (type->kind == TYPE_ARRAY || type->kind == TYPE_IARRAY))
+    error("an array can not be passed by value as a parameter to a function");
+  SymbolEntry *p = newParameter(id, type, pm, currFunction);
+  if (p) addSlot(p, id);												// its slot in the frame
   return;
 }
 
@@ -168,7 +377,7 @@ void ASTAssign::sem() {
   if (left->type->kind == TYPE_ARRAY || left->type->kind == TYPE_IARRAY)
     error("left side of assignment can not be an array");
   right->sem();																// semantic analysis of expression
-  SymbolEntry * e = lookupEntry(left->id.c_str(), LOOKUP_ALL_SCOPES, false);
+  SymbolEntry * e = lookupEntry(left->name(), LOOKUP_ALL_SCOPES, false);
   if (!e)
     return;
   if (right->type==NULL)
@@ -185,10 +394,17 @@ void ASTFcall::sem() {
   if (!f)
     return;
   if (f->entryType != ENTRY_FUNCTION)
-    error("%s is not a function", id);
+    error("%s is not a function", id->text);
   type = f->u.eFunction.resultType;						// node's type <- function's type
   if (left) left->sem();											// semantic analysis of parameter list
 
+  // the function, and what is passed for the variables it takes: the
+  // variables their names are here
+  if (f->entryType == ENTRY_FUNCTION) {
+    function = f->slot;
+    outer = passedSlots(function);
+  }
+
   ASTNode *currPar = left;																	// currPar <- 1st given parameter
   SymbolEntry *expectedPar = f->u.eFunction.firstArgument;	// expectedPar <- 1st expected parameter
 
@@ -200,18 +416,14 @@ void ASTFcall::sem() {
 
     Type expectedParType = expectedPar->u.eParameter.type;
     Type currParType = currPar->left->type;
+    Symbol currParName = currPar->left->name();
 
-    // expected parameter passed by reference:
+    // expected parameter passed by reference: error if actual parameter
+    // is not an l-value, that is a variable, a parameter (or an element
+    // of one) or a string literal; not a call, a constant or an operation
     if (expectedPar->u.eParameter.mode == PASS_BY_REFERENCE) {
-    // error if actual parameter:
-    // --> has no id
-      if (currPar->left->id.empty()) {
-        error("parameters passed by reference must be l-values");
-        return;
-      }
-      // --> is not an l-value
-      Type charArrayType = typeArray(currPar->left->id.length(), typeChar);
-      if (!equalType(currParType, charArrayType) && !lookupEntry(currPar->left->id.c_str(), LOOKUP_ALL_SCOPES, false)) {
+      SymbolEntry *e = currPar->left->nodeKind == AST_ID ? lookupEntry(currParName, LOOKUP_ALL_SCOPES, false) : NULL;
+      if (currPar->left->nodeKind != AST_STRING && (!e || e->entryType == ENTRY_FUNCTION)) {
         error("parameters passed by reference must be l-values");
         return;
       }
@@ -221,7 +433,7 @@ void ASTFcall::sem() {
     if (expectedParType->kind == TYPE_IARRAY) {
       if ((currParType->kind != TYPE_ARRAY) && (currParType->kind != TYPE_IARRAY))
         error("function parameter expected to be an array");
-      if (!equalType(expectedParType->refType, currParType->refType))
+      else if (!equalType(expectedParType->refType, currParType->refType))
         error("function parameter expected to be an array of different type");
     }
     else {
@@ -242,7 +454,7 @@ void ASTFcall::sem() {
 void ASTFcall_stmt::sem() {
 	linecount = line;
   left->sem();																// semantic analysis of function call
-  SymbolEntry * f = lookupEntry(left->id.c_str(), LOOKUP_ALL_SCOPES, false);
+  SymbolEntry * f = lookupEntry(left->name(), LOOKUP_ALL_SCOPES, false);
   if (!f)
     return;
   if (f->u.eFunction.resultType->kind != TYPE_VOID)
@@ -304,10 +516,15 @@ void ASTRet::sem() {
 }
 
 // semantic analysis of ASTSeq Node
+// (a loop down the chain, not a call per node: lists can be longer
+// than the stack is deep)
 void ASTSeq::sem() {
-	linecount = line;
-  if (left) left->sem();											// semantic analysis of 1st node
-  if (right) right->sem();										// semantic analysis of the rest of seq
+  ASTNode *seq = this;
+  for (; seq && seq->nodeKind == AST_SEQ; seq = seq->right) {
+  	linecount = seq->line;
+    if (seq->left) seq->left->sem();					// semantic analysis of this node
+  }
+  if (seq) seq->sem();												// a seq that does not end in one
   return;
 }
 
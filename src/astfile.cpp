@@ -0,0 +1,390 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "astfile.hpp"
+#include "general.hpp"
+#include "source.hpp"
+
+/* ---------------------------------------------------------------------
+   ---- the layout: a header, the types, the nodes, the slots and the --
+   ---- names, one after the other, all of it 4-aligned and in the -----
+   ---- byte order of the compiler that wrote it; nodes and types ------
+   ---- refer to each other by index, to lists of slots by index and ---
+   ---- to names by offset, NIL meaning none ---------------------------
+   --------------------------------------------------------------------- */
+
+static const char MAGIC[8] = "ALANAST";
+static const uint32_t NIL = 0xffffffff;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;      // AST_FORMAT_VERSION
+  uint32_t numTypes;     // in the file, after the basic ones
+  uint32_t numNodes;
+  uint32_t namesSize;    // bytes
+  uint32_t root;
+  uint32_t numSlots;     // int32s
+} FileHeader;
+
+// the basic types are not in the file: their indices come first
+static const Type basicTypes[] = { typeVoid, typeInteger, typeBoolean, typeChar, typeReal };
+#define BASIC_TYPES 5
+
+typedef struct {
+  uint32_t kind;         // kind_t
+  uint32_t refType;      // always a lower index
+  int32_t size;
+} FileType;
+
+// in breadth-first order, so that children come after their parent
+typedef struct {
+  uint8_t nodeKind, op, pm, unused;
+  int32_t line;
+  uint32_t type;
+  uint32_t left, right;
+  uint32_t name;         // of nodes that have one; an ASTString's text
+  int32_t a, b;          // num of ASTInt, c of ASTChar, slot of ASTId and
+                         // ASTVdef, num_vars and outer of ASTFdecl,
+                         // function and outer of ASTFcall
+} FileNode;
+
+// the slots are lists of slots (see ast.hpp), a count and the slots
+
+// a name is its length (4 bytes), its text and a NUL, padded to 4 bytes
+
+/* ---------------------------------------------------------------------
+   -------------------------------- writing ----------------------------
+   --------------------------------------------------------------------- */
+
+typedef struct {
+  std::vector<FileType> types;
+  std::vector<FileNode> nodes;
+  std::vector<int32_t> slots;
+  std::string names;
+  std::unordered_map<Type, uint32_t> typeIndex;
+  std::unordered_map<Symbol, uint32_t> nameOffset;
+  std::unordered_map<const int *, int32_t> slotIndex;   // calls share them
+} Writer;
+
+static uint32_t typeIndex(Writer &w, Type type) {
+  if (type == nullptr) return NIL;
+  for (uint32_t i = 0; i < BASIC_TYPES; i++)
+    if (type == basicTypes[i]) return i;
+  auto found = w.typeIndex.find(type);
+  if (found != w.typeIndex.end()) return found->second;
+  FileType t = { (uint32_t) type->kind, typeIndex(w, type->refType), type->size };
+  uint32_t index = BASIC_TYPES + w.types.size();
+  w.types.push_back(t);
+  w.typeIndex[type] = index;
+  return index;
+}
+
+static uint32_t nameOffset(Writer &w, Symbol name) {
+  if (name == nullptr) return NIL;
+  auto found = w.nameOffset.find(name);
+  if (found != w.nameOffset.end()) return found->second;
+  uint32_t offset = w.names.size(), length = name->length;
+  w.names.append((const char *) &length, 4);
+  w.names.append(name->text, length);
+  w.names.append(4 - length % 4, '\0');
+  w.nameOffset[name] = offset;
+  return offset;
+}
+
+static int32_t slotList(Writer &w, const int *list) {
+  if (list == nullptr) return NIL;
+  auto found = w.slotIndex.find(list);
+  if (found != w.slotIndex.end()) return found->second;
+  int32_t index = w.slots.size();
+  w.slots.insert(w.slots.end(), list, list + list[0] + 1);
+  w.slotIndex[list] = index;
+  return index;
+}
+
+void writeAST(const char *path, ASTNode *t) {
+  Writer w;
+  std::vector<ASTNode *> queue = { t };
+  for (size_t i = 0; i < queue.size(); i++) {
+    ASTNode *n = queue[i];
+    FileNode r = { n->nodeKind, 0, 0, 0, n->line, typeIndex(w, n->type), NIL, NIL,
+                   nameOffset(w, n->nodeKind == AST_CHAR ? nullptr : n->name()), 0, 0 };
+    switch (n->nodeKind) {
+      case AST_ID:    r.a = static_cast<ASTId *>(n)->slot; break;
+      case AST_INT:   r.a = static_cast<ASTInt *>(n)->num; break;
+      case AST_CHAR:  r.a = static_cast<ASTChar *>(n)->c; break;
+      case AST_VDEF:  r.a = static_cast<ASTVdef *>(n)->slot; break;
+      case AST_FDECL:
+        r.a = static_cast<ASTFdecl *>(n)->num_vars;
+        r.b = slotList(w, static_cast<ASTFdecl *>(n)->outer);
+        break;
+      case AST_FCALL:
+        r.a = static_cast<ASTFcall *>(n)->function;
+        r.b = slotList(w, static_cast<ASTFcall *>(n)->outer);
+        break;
+      case AST_PAR:   r.pm = n->pm; break;
+      case AST_OP:    r.op = n->op; break;
+      default: break;
+    }
+    if (n->left) {
+      r.left = queue.size();
+      queue.push_back(n->left);
+    }
+    if (n->right) {
+      r.right = queue.size();
+      queue.push_back(n->right);
+    }
+    w.nodes.push_back(r);
+  }
+
+  FileHeader h = { {}, AST_FORMAT_VERSION, (uint32_t) w.types.size(), (uint32_t) w.nodes.size(),
+                   (uint32_t) w.names.size(), 0, (uint32_t) w.slots.size() };
+  memcpy(h.magic, MAGIC, sizeof(h.magic));
+  FILE *f = strcmp(path, "-") ? fopen(path, "wb") : stdout;
+  if (f == NULL) fatal("\rcannot create %s", path);
+  fwrite(&h, sizeof(h), 1, f);
+  fwrite(w.types.data(), sizeof(FileType), w.types.size(), f);
+  fwrite(w.nodes.data(), sizeof(FileNode), w.nodes.size(), f);
+  fwrite(w.slots.data(), sizeof(int32_t), w.slots.size(), f);
+  fwrite(w.names.data(), 1, w.names.size(), f);
+  if (ferror(f) || (f != stdout && fclose(f) != 0) || (f == stdout && fflush(f) != 0))
+    fatal("\rcannot write %s", path);
+}
+
+/* ---------------------------------------------------------------------
+   -------------------------------- reading ----------------------------
+   --------------------------------------------------------------------- */
+
+bool isCheckedAST() {
+  return sourceLength >= sizeof(MAGIC) && !memcmp(sourceText, MAGIC, sizeof(MAGIC));
+}
+
+static void corrupt(const char *what) {
+  fatal("\rthe checked AST is corrupt (%s)", what);
+}
+
+// the name at offset of the names; its text is left where it is
+static const char *nameAt(const char *names, uint32_t size, uint32_t offset, int *length) {
+  uint32_t n;
+  if (offset >= size || size - offset < 4) corrupt("name out of bounds");
+  memcpy(&n, names + offset, 4);
+  if (n >= size - offset - 4 || names[offset + 4 + n] != '\0') corrupt("name out of bounds");
+  *length = n;
+  return names + offset + 4;
+}
+
+// the list of slots at index of the slots; it is left where it is
+static const int *slotsAt(const int32_t *slots, uint32_t size, int32_t index) {
+  if ((uint32_t) index == NIL) return nullptr;
+  if ((uint32_t) index >= size || slots[index] < 0 || (uint32_t) slots[index] >= size - index)
+    corrupt("slots out of bounds");
+  return slots + index;
+}
+
+// the shape of the tree, as the parser builds it and codegen walks it:
+// each kind of node has the children it needs, of the kinds it needs
+
+static bool isExpr(ASTNode *n) {
+  switch (n->nodeKind) {
+    case AST_ID: case AST_INT: case AST_CHAR: case AST_STRING: case AST_OP: case AST_FCALL:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool isStmt(ASTNode *n) {
+  switch (n->nodeKind) {
+    case AST_SEQ: case AST_ASSIGN: case AST_FCALL_STMT: case AST_IF:
+    case AST_IFELSE: case AST_WHILE: case AST_RET:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool isDef(ASTNode *n) {
+  return n->nodeKind == AST_VDEF || n->nodeKind == AST_FDEF;
+}
+
+static bool isPar(ASTNode *n) {
+  return n->nodeKind == AST_PAR;
+}
+
+// a list (see ast.hpp) of elements of the kind is; holes are the empty
+// statements of a block
+static bool isList(ASTNode *seq, bool (*is)(ASTNode *), bool holes) {
+  for (; seq != nullptr; seq = seq->right)
+    if (seq->nodeKind != AST_SEQ || (seq->left ? !is(seq->left) : !holes)) return false;
+  return true;
+}
+
+// a block: a list of statements, each of them a block too perhaps; in a
+// loop, not recursively, however deep the blocks
+static bool isBlock(ASTNode *seq) {
+  std::vector<ASTNode *> blocks = { seq };
+  while (!blocks.empty()) {
+    seq = blocks.back();
+    blocks.pop_back();
+    if (!isList(seq, isStmt, true)) return false;
+    for (; seq != nullptr; seq = seq->right)
+      if (seq->left && seq->left->nodeKind == AST_SEQ) blocks.push_back(seq->left);
+  }
+  return true;
+}
+
+// a statement that may be missing (the body of an if or a while)
+static bool isOptionalStmt(ASTNode *n) {
+  return n == nullptr || (n->nodeKind == AST_SEQ ? isBlock(n) : isStmt(n));
+}
+
+static void checkShape(ASTNode *n) {
+  ASTNode *l = n->left, *r = n->right;
+  bool ok;
+  switch (n->nodeKind) {
+    case AST_ID:         ok = n->type && (!l || isExpr(l)) && !r; break;
+    case AST_INT:
+    case AST_CHAR:
+    case AST_STRING:     ok = !l && !r; break;
+    case AST_VDEF:
+    case AST_PAR:        ok = n->type && !l && !r; break;
+    case AST_SEQ:        ok = !r || r->nodeKind == AST_SEQ; break;   // by its owner
+    case AST_FDEF:       ok = l && l->nodeKind == AST_FDECL && isBlock(r); break;
+    case AST_FDECL:      ok = n->type && isList(l, isPar, false) && isList(r, isDef, false); break;
+    case AST_ASSIGN:     ok = l && l->nodeKind == AST_ID && r && isExpr(r); break;
+    case AST_FCALL:      ok = isList(l, isExpr, false) && !r; break;
+    case AST_FCALL_STMT: ok = l && l->nodeKind == AST_FCALL && !r; break;
+    case AST_IF:
+    case AST_WHILE:      ok = l && isExpr(l) && isOptionalStmt(r); break;
+    case AST_IFELSE:     ok = l && l->nodeKind == AST_IF && isOptionalStmt(r); break;
+    case AST_RET:        ok = (!l || isExpr(l)) && !r; break;
+    case AST_OP:
+      switch (n->op) {
+        case TRUE_: case FALSE_: ok = !l && !r; break;
+        case NOT:                ok = !l && r && isExpr(r); break;
+        default:                 ok = l && isExpr(l) && r && isExpr(r); break;
+      }
+      break;
+    default:             ok = false;
+  }
+  if (!ok) corrupt("node of the wrong shape");
+}
+
+ASTNode *readAST() {
+  FileHeader h;
+  if (sourceLength < sizeof(h)) corrupt("no header");
+  memcpy(&h, sourceText, sizeof(h));
+  if (h.version != AST_FORMAT_VERSION)
+    fatal("\rthe checked AST is of format %u; this compiler reads format %d", h.version, AST_FORMAT_VERSION);
+  unsigned long long size = sizeof(h) + (unsigned long long) h.numTypes * sizeof(FileType) +
+                            (unsigned long long) h.numNodes * sizeof(FileNode) +
+                            (unsigned long long) h.numSlots * sizeof(int32_t) + h.namesSize;
+  if (size != sourceLength) corrupt("wrong size");
+  if (h.root >= h.numNodes) corrupt("no root");
+  const FileType *fileTypes = (const FileType *) (sourceText + sizeof(h));
+  const FileNode *fileNodes = (const FileNode *) (fileTypes + h.numTypes);
+  const int32_t *slots = (const int32_t *) (fileNodes + h.numNodes);
+  const char *names = (const char *) (slots + h.numSlots);
+
+  std::vector<Type> types(basicTypes, basicTypes + BASIC_TYPES);
+  for (uint32_t i = 0; i < h.numTypes; i++) {
+    const FileType &t = fileTypes[i];
+    if (t.refType >= types.size()) corrupt("type out of bounds");
+    Type ref = types[t.refType];
+    switch (t.kind) {
+      case TYPE_ARRAY:   types.push_back(typeArray(t.size, ref)); break;
+      case TYPE_IARRAY:  types.push_back(typeIArray(ref)); break;
+      case TYPE_POINTER: types.push_back(typePointer(ref)); break;
+      default: corrupt("unknown type");
+    }
+  }
+
+  // backwards: the children of a node are built before it
+  std::vector<ASTNode *> nodes(h.numNodes);
+  for (uint32_t i = h.numNodes; i-- > 0; ) {
+    const FileNode &r = fileNodes[i];
+    if (r.type != NIL && r.type >= types.size()) corrupt("type out of bounds");
+    if ((r.left != NIL && (r.left <= i || r.left >= h.numNodes)) ||
+        (r.right != NIL && (r.right <= i || r.right >= h.numNodes)))
+      corrupt("node out of bounds");
+    int length = 0;
+    const char *text = r.name == NIL ? nullptr : nameAt(names, h.namesSize, r.name, &length);
+    Symbol name = text && r.nodeKind != AST_STRING ? intern(text, length) : nullptr;
+    Type type = r.type == NIL ? nullptr : types[r.type];
+    ASTNode *left = r.left == NIL ? nullptr : nodes[r.left];
+    ASTNode *right = r.right == NIL ? nullptr : nodes[r.right];
+    if (name == nullptr && (r.nodeKind == AST_ID || r.nodeKind == AST_FCALL || r.nodeKind == AST_VDEF ||
+                            r.nodeKind == AST_FDECL || r.nodeKind == AST_PAR))
+      corrupt("name missing");
+    ASTNode *n;
+    switch (r.nodeKind) {
+      case AST_ID: {
+        ASTId *id = new ASTId(name, left);
+        id->slot = r.a;
+        n = id;
+        break;
+      }
+      case AST_INT:  n = new ASTInt(r.a); break;
+      case AST_CHAR: n = new ASTChar(r.a); break;
+      case AST_STRING: {
+        // decoded already: its text is read in place, not interned
+        if (text == nullptr) corrupt("string without text");
+        SymbolName *decoded = (SymbolName *) astArena.allocate(sizeof(SymbolName));
+        decoded->text = text;
+        decoded->length = length;
+        decoded->hash = 0;
+        ASTString *s = new ASTString({ text, length });
+        s->id = decoded;
+        n = s;
+        break;
+      }
+      case AST_VDEF: {
+        ASTVdef *vdef = new ASTVdef(name, type, 0);
+        vdef->slot = r.a;
+        n = vdef;
+        break;
+      }
+      case AST_SEQ:   n = new ASTSeq(left, right); break;
+      case AST_FDEF:  n = new ASTFdef(left, right); break;
+      case AST_FDECL: {
+        ASTFdecl *fdecl = new ASTFdecl(name, type, left, right);
+        fdecl->num_vars = r.a;
+        fdecl->outer = slotsAt(slots, h.numSlots, r.b);
+        n = fdecl;
+        break;
+      }
+      case AST_PAR:        n = new ASTPar(name, type, r.pm ? PASS_BY_REFERENCE : PASS_BY_VALUE); break;
+      case AST_ASSIGN:     n = new ASTAssign(left, right); break;
+      case AST_FCALL: {
+        ASTFcall *fcall = new ASTFcall(name, left);
+        fcall->function = r.a;
+        fcall->outer = slotsAt(slots, h.numSlots, r.b);
+        n = fcall;
+        break;
+      }
+      case AST_FCALL_STMT: n = new ASTFcall_stmt(left); break;
+      case AST_IF:         n = new ASTIf(left, right); break;
+      case AST_IFELSE:     n = new ASTIfelse(left, right); break;
+      case AST_WHILE:      n = new ASTWhile(left, right); break;
+      case AST_RET:        n = new ASTRet(left); break;
+      case AST_OP:
+        if (r.op > MOD) corrupt("unknown operator");
+        n = new ASTOp(left, (kind) r.op, right);
+        break;
+      default:
+        corrupt("unknown node");
+        return nullptr;
+    }
+    n->line = r.line;
+    n->type = type;
+    n->left = left;
+    n->right = right;
+    checkShape(n);
+    nodes[i] = n;
+  }
+  if (nodes[h.root]->nodeKind != AST_FDEF) corrupt("the root is not a function");
+  return nodes[h.root];
+}
@@ -0,0 +1,296 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "general.hpp"
+#include "options.hpp"
+#include "cache.hpp"
+#include "emit.hpp"
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/SHA1.h>
+
+// the cache lives in $ALAN_CACHE_DIR, else in $XDG_CACHE_HOME/alan, else
+// in ~/.cache/alan
+static std::string cacheDir() {
+  const char *dir = getenv("ALAN_CACHE_DIR");
+  if (dir != NULL && dir[0] != '\0') return dir;
+  const char *xdg = getenv("XDG_CACHE_HOME");
+  if (xdg != NULL && xdg[0] != '\0') return std::string(xdg) + "/alan";
+  const char *home = getenv("HOME");
+  return std::string(home != NULL ? home : "/tmp") + "/.cache/alan";
+}
+
+// size limit, $ALAN_CACHE_SIZE in MiB
+static off_t cacheLimit() {
+  const char *size = getenv("ALAN_CACHE_SIZE");
+  long mib = size != NULL ? atol(size) : 0;
+  return (off_t) (mib > 0 ? mib : 512) << 20;
+}
+
+// create dir and its parents, as mkdir -p
+static bool makeDirs(const std::string &dir) {
+  for (size_t slash = dir.find('/', 1); ; slash = dir.find('/', slash + 1)) {
+    std::string prefix = dir.substr(0, slash);
+    if (mkdir(prefix.c_str(), 0700) < 0 && errno != EEXIST) return false;
+    if (slash == std::string::npos) return true;
+  }
+}
+
+// copy from into to atomically (via a temporary and rename), with mode
+static bool copyFile(const char *from, const std::string &to, mode_t mode) {
+  int in = open(from, O_RDONLY);
+  if (in < 0) return false;
+  std::string temp = to + ".XXXXXX";
+  int out = mkstemp(&temp[0]);
+  if (out < 0) {
+    close(in);
+    return false;
+  }
+  char buf[1 << 16];
+  ssize_t n;
+  bool ok = true;
+  while (ok && (n = read(in, buf, sizeof(buf))) != 0) {
+    if (n < 0) ok = errno == EINTR;
+    else ok = write(out, buf, n) == n;
+  }
+  close(in);
+  ok = fchmod(out, mode) == 0 && close(out) == 0 && ok;
+  if (ok && rename(temp.c_str(), to.c_str()) == 0) return true;
+  unlink(temp.c_str());
+  return false;
+}
+
+static void hashFileIdentity(llvm::SHA1 &sha, const std::string &path) {
+  struct stat st;
+  char id[128];
+  if (stat(path.c_str(), &st) < 0) memset(&st, 0, sizeof(st));
+  snprintf(id, sizeof(id), "%s:%lu:%lu:%ld:%ld\n", path.c_str(), (unsigned long) st.st_dev,
+           (unsigned long) st.st_ino, (long) st.st_size, (long) st.st_mtime);
+  sha.update(id);
+}
+
+// what every key depends on: the compiler, the target and the flags
+static void hashSettings(llvm::SHA1 &sha, const char *kind, const std::string &compiler) {
+  static const char *levels[] = { "O0", "O1", "O2", "O3", "Os", "Oz" };
+  std::string cpu = options.cpu ? options.cpu : "generic";
+  std::string features = options.features ? options.features : "";
+  if (cpu == "native") cpu = llvm::sys::getHostCPUName().str();
+  if (features == "native") features = hostFeatures();
+
+  sha.update(std::string("alan ") + LLVM_VERSION_STRING + " " + kind + "\n");
+  hashFileIdentity(sha, compiler);
+  sha.update(llvm::sys::getDefaultTargetTriple() + " " + levels[options.optLevel] + " " +
+             cpu + " " + features + "\n");
+}
+
+std::string cacheKey(llvm::StringRef source, const char *kind,
+                     const std::string &compiler, const std::string &library) {
+  llvm::SHA1 sha;
+  hashSettings(sha, kind, compiler);
+  if (!strcmp(kind, "exe")) {
+    const char *linker = getenv("CC");
+    sha.update(std::string("link ") + (linker != NULL ? linker : "") + "\n");
+    hashFileIdentity(sha, library);
+  }
+  sha.update(source);
+  return llvm::toHex(sha.final(), true) + "." + kind;
+}
+
+std::string functionKey(llvm::StringRef ir) {
+  static int here;
+  llvm::SHA1 sha;
+  hashSettings(sha, "bc", llvm::sys::fs::getMainExecutable(NULL, &here));
+  sha.update(ir);
+  return llvm::toHex(sha.final(), true) + ".bc";
+}
+
+/* ---------------------------------------------------------------------
+   ----------------------- statistics and eviction ---------------------
+   ---- the file stats holds "hits misses bytes fhits fmisses", --------
+   ---- read and rewritten under an exclusive lock, which also ---------
+   ---- serializes eviction --------------------------------------------
+   --------------------------------------------------------------------- */
+
+typedef struct {
+  unsigned long hits, misses;
+  long long bytes;
+  unsigned long functionHits, functionMisses;
+} CacheStats;
+
+static int lockStats(CacheStats *stats) {
+  std::string path = cacheDir() + "/stats";
+  int fd = open(path.c_str(), O_RDWR | O_CREAT, 0600);
+  if (fd < 0) return -1;
+  flock(fd, LOCK_EX);
+  char buf[128];
+  ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+  buf[n > 0 ? n : 0] = '\0';
+  memset(stats, 0, sizeof(*stats));
+  sscanf(buf, "%lu %lu %lld %lu %lu", &stats->hits, &stats->misses, &stats->bytes,
+         &stats->functionHits, &stats->functionMisses);
+  return fd;
+}
+
+static void unlockStats(int fd, const CacheStats *stats) {
+  char buf[128];
+  int n = snprintf(buf, sizeof(buf), "%lu %lu %lld %lu %lu\n", stats->hits, stats->misses,
+                   stats->bytes, stats->functionHits, stats->functionMisses);
+  if (pwrite(fd, buf, n, 0) == n) (void) ftruncate(fd, n);
+  close(fd);   // releases the lock
+}
+
+typedef struct {
+  std::string path;
+  time_t used;
+  off_t size;
+} CacheEntry;
+
+static bool hasSuffix(const char *name, const char *suffix) {
+  size_t len = strlen(name), n = strlen(suffix);
+  return len > n && !strcmp(name + len - n, suffix);
+}
+
+static bool isEntry(const char *name) {
+  return hasSuffix(name, ".o") || hasSuffix(name, ".exe") || hasSuffix(name, ".bc");
+}
+
+static std::vector<CacheEntry> entries() {
+  std::vector<CacheEntry> all;
+  std::string dir = cacheDir();
+  DIR *d = opendir(dir.c_str());
+  if (d == NULL) return all;
+  struct dirent *e;
+  struct stat st;
+  while ((e = readdir(d)) != NULL) {
+    if (!isEntry(e->d_name)) continue;
+    CacheEntry entry = { dir + "/" + e->d_name, 0, 0 };
+    if (stat(entry.path.c_str(), &st) < 0) continue;
+    entry.used = st.st_mtime;
+    entry.size = st.st_size;
+    all.push_back(entry);
+  }
+  closedir(d);
+  return all;
+}
+
+// drop the least recently used entries until the cache is at 3/4 of its
+// limit; the total is recounted here, which also repairs any drift
+static void evict(CacheStats *stats) {
+  std::vector<CacheEntry> all = entries();
+  std::sort(all.begin(), all.end(), [](const CacheEntry &a, const CacheEntry &b) {
+    return a.used < b.used;
+  });
+  stats->bytes = 0;
+  for (auto &e : all) stats->bytes += e.size;
+  off_t target = cacheLimit() / 4 * 3;
+  for (size_t i = 0; i < all.size() && stats->bytes > target; i++)
+    if (unlink(all[i].path.c_str()) == 0) stats->bytes -= all[i].size;
+}
+
+/* ---------------------------------------------------------------------
+   ------------------------------- entries -----------------------------
+   --------------------------------------------------------------------- */
+
+bool cacheFetch(const std::string &key, const char *output) {
+  std::string dir = cacheDir();
+  if (!makeDirs(dir)) return false;
+  std::string path = dir + "/" + key;
+  struct stat st;
+  bool hit = stat(path.c_str(), &st) == 0 && copyFile(path.c_str(), output, st.st_mode & 0777);
+  if (hit) utimes(path.c_str(), NULL);   // recently used
+
+  CacheStats stats;
+  int fd = lockStats(&stats);
+  if (fd < 0) return hit;
+  if (hit) stats.hits++;
+  else stats.misses++;
+  unlockStats(fd, &stats);
+  return hit;
+}
+
+void cacheStore(const std::string &key, const char *output) {
+  std::string path = cacheDir() + "/" + key;
+  struct stat st;
+  if (stat(output, &st) < 0 || !copyFile(output, path, st.st_mode & 0777)) return;
+
+  CacheStats stats;
+  int fd = lockStats(&stats);
+  if (fd < 0) return;
+  stats.bytes += st.st_size;
+  if (stats.bytes > cacheLimit()) evict(&stats);
+  unlockStats(fd, &stats);
+}
+
+bool cacheLoad(const std::string &key, std::string &data) {
+  std::string path = cacheDir() + "/" + key;
+  FILE *f = fopen(path.c_str(), "r");
+  if (f == NULL) return false;
+  char buf[1 << 16];
+  size_t n;
+  data.clear();
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.append(buf, n);
+  bool ok = !ferror(f);
+  fclose(f);
+  if (ok) utimes(path.c_str(), NULL);   // recently used
+  return ok;
+}
+
+long cacheSave(const std::string &key, llvm::StringRef data) {
+  std::string dir = cacheDir();
+  if (!makeDirs(dir)) return 0;
+  std::string path = dir + "/" + key, temp = path + ".XXXXXX";
+  int fd = mkstemp(&temp[0]);
+  if (fd < 0) return 0;
+  bool ok = write(fd, data.data(), data.size()) == (ssize_t) data.size();
+  ok = fchmod(fd, 0644) == 0 && close(fd) == 0 && ok;
+  if (ok && rename(temp.c_str(), path.c_str()) == 0) return data.size();
+  unlink(temp.c_str());
+  return 0;
+}
+
+void cacheCount(unsigned long functionHits, unsigned long functionMisses, long bytes) {
+  CacheStats stats;
+  int fd = lockStats(&stats);
+  if (fd < 0) return;
+  stats.functionHits += functionHits;
+  stats.functionMisses += functionMisses;
+  stats.bytes += bytes;
+  if (stats.bytes > cacheLimit()) evict(&stats);
+  unlockStats(fd, &stats);
+}
+
+void printCacheStats() {
+  std::string dir = cacheDir();
+  CacheStats stats;
+  int fd = makeDirs(dir) ? lockStats(&stats) : -1;
+  if (fd < 0) fatal("\rcannot open the cache in %s", dir.c_str());
+  std::vector<CacheEntry> all = entries();
+  stats.bytes = 0;
+  for (auto &e : all) stats.bytes += e.size;
+  unsigned long lookups = stats.hits + stats.misses;
+  printf("cache directory: %s\n", dir.c_str());
+  printf("entries:         %lu\n", (unsigned long) all.size());
+  printf("size:            %.1f of %.1f MiB\n", stats.bytes / 1048576.0, cacheLimit() / 1048576.0);
+  printf("hits:            %lu\n", stats.hits);
+  printf("misses:          %lu\n", stats.misses);
+  printf("hit rate:        %.1f%%\n", lookups ? 100.0 * stats.hits / lookups : 0.0);
+  lookups = stats.functionHits + stats.functionMisses;
+  printf("function hits:   %lu\n", stats.functionHits);
+  printf("function misses: %lu\n", stats.functionMisses);
+  printf("function rate:   %.1f%%\n", lookups ? 100.0 * stats.functionHits / lookups : 0.0);
+  unlockStats(fd, &stats);
+}
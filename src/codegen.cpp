@@ -1,6 +1,22 @@
 #include "codegen.hpp"
+#include "optimize.hpp"
+#include "emit.hpp"
+#include "jit.hpp"
+#include "memreport.hpp"
+#include "trace.hpp"
 #include <list>
 
+#include <llvm/ADT/SmallString.h>
+
+// the context before the module, which must go first
+thread_local llvm::LLVMContext TheContext;
+thread_local llvm::IRBuilder<> Builder(TheContext);
+thread_local std::unique_ptr<llvm::Module> TheModule;
+
+thread_local llvm::Type * i8   = llvm::IntegerType::get(TheContext, 8);
+thread_local llvm::Type * i32  = llvm::IntegerType::get(TheContext, 32);
+thread_local llvm::Type * proc = llvm::Type::getVoidTy(TheContext);
+
 // function that translates symbol table types to llvm types
 llvm::Type * type_to_llvm(Type type, PassMode pm = PASS_BY_VALUE) {
   llvm::Type *llvmtype;
@@ -28,7 +44,10 @@ llvm::Type * type_to_llvm(Type type, PassMode pm = PASS_BY_VALUE) {
 }
 
 // contains necessary variable and function information
-Logger logger;
+thread_local Logger logger;
+
+// --single-pass: codegen from within sem()
+thread_local bool singlePass = false;
 
 // dereferencing function
 llvm::Value *deref (llvm::Value *var) {
@@ -38,18 +57,16 @@ llvm::Value *deref (llvm::Value *var) {
 }
 
 // calculate variable address
-llvm::Value *calcAddr (ASTNode *var, string function) {
+llvm::Value *calcAddr (ASTId *var, string function) {
 	llvm::Value *addr;
-	llvm::Type *t;
+	llvm::AllocaInst *alloca = logger.getVarAlloca(var->slot);
+	llvm::Type *t = alloca->getAllocatedType();
 	// dereference if necessary
-	if (logger.isPointer(var->id)) {
-		addr = Builder.CreateLoad(logger.getVarAlloca(var->id));
-		t = logger.getVarType(var->id)->getPointerElementType();
-	}
-	else {
-		addr = logger.getVarAlloca(var->id);
-		t = logger.getVarType(var->id);
+	if (t->isPointerTy()) {
+		addr = Builder.CreateLoad(alloca);
+		t = t->getPointerElementType();
 	}
+	else addr = alloca;
   
 	if (var->type->refType != nullptr) {
 		// id is an array
@@ -90,11 +107,13 @@ llvm::Value *calcAddr (ASTNode *var, string function) {
 
 void createstdlib();
 
-// this is the main codegen function (called by main())
-void codegen(ASTNode *t) {
+// the entry block of main() of the output program, to call it from
+static thread_local llvm::BasicBlock *MainBB;
+
+// steps 1 to 3 of codegen()
+static void openModule() {
   // step 1: initiate the module
   TheModule = llvm::make_unique<llvm::Module>(filename, TheContext);
-  logger.openScope();
 
   // step 2: create alan stdlib functions
   createstdlib();
@@ -102,14 +121,11 @@ void codegen(ASTNode *t) {
   // step 3: create the main function of the output program
   llvm::FunctionType *MainType = llvm::FunctionType::get(i32, vector<llvm::Type*>{}, false);
   llvm::Function *MainF = llvm::Function::Create(MainType, llvm::Function::ExternalLinkage, "main", TheModule.get());
-  logger.addFunctionInScope("main", MainF);
-  llvm::BasicBlock *MainBB = llvm::BasicBlock::Create(TheContext, "entry", MainF);
-
-  // step 4: create LLVM IR of input program
-  t->codegen();
+  MainBB = llvm::BasicBlock::Create(TheContext, "entry", MainF);
+}
 
-  // step 5: create a call to the main function
-  llvm::Function *F = logger.getFunctionInScope(t->left->id);
+// step 5 of codegen(): F is the program function
+static void callProgram(llvm::Function *F) {
   Builder.SetInsertPoint(MainBB);
   // if main function has void type, call it and return 0
   if (F->getReturnType()->isVoidTy()) {
@@ -118,17 +134,217 @@ void codegen(ASTNode *t) {
   }
   // else, call it and return the value it returns
   else Builder.CreateRet(Builder.CreateCall(F, vector<llvm::Value*>{}));
+}
+
+// steps 6 to 8 of codegen()
+static void finishModule() {
+  // step 6: optimize (in-process, no round trip through opt)
+  std::unique_ptr<llvm::TargetMachine> TM(targetMachine(*TheModule));
+  if (options.incremental)
+    optimizeIncrementally(*TheModule, options.optLevel, TM.get());
+  else
+    optimize(*TheModule, options.optLevel, TM.get());
+
+  // step 7: emit the requested outputs
+  if (!options.run) {
+    emit(*TheModule, TM.get());
+    return;
+  }
+
+  // step 8: --run: keep the object code in memory and execute it
+  llvm::SmallString<0> obj;
+  emit(*TheModule, TM.get(), &obj);
+  if (tracing) traceBegin("Run");
+  if (memReporting) memPhase(PHASE_RUN);
+  run(obj);
+}
+
+// this is the main codegen function (called by main())
+void codegen(ASTNode *t) {
+  if (tracing) traceBegin("Codegen");
+  if (memReporting) memPhase(PHASE_CODEGEN);
+
+  // steps 1 to 3: module, stdlib and main()
+  openModule();
+
+  // step 4: create LLVM IR of input program
+  llvm::Function *F = (llvm::Function *) t->codegen();
+
+  // step 5: create a call to the main function
+  callProgram(F);
+  if (tracing) traceEnd();
+  if (memReporting) memPhase(PHASE_DRIVER);
+
+  // steps 6 to 8: optimize, emit, run
+  finishModule();
+}
+
+// ASTFdef::codegen() steps 1 to 3: the function, its scopelog and the
+// slots of its parameters
+static llvm::Function * openFunction(ASTFdecl *fdecl) {
+  string Fname = fdecl->name()->text;
+  llvm::Type *retType = type_to_llvm(fdecl->type);
+  vector<Symbol> parameterNames;
+  vector<llvm::Type *> parameterTypes;
+
+  // step 1a: log param types and names
+  for (ASTNode *params = fdecl->left; params != nullptr; params = params->right) {
+    parameterNames.push_back(params->left->name());
+    parameterTypes.push_back(type_to_llvm(params->left->type, params->left->pm));
+  }
+
+  // step 1b: add references to the outer scope variables sem() gave it
+  // as parameters (in the order they were declared, so that the IR is
+  // the same every time)
+  const int *outer = fdecl->outer;
+  for (int i = 1; outer != nullptr && i <= outer[0]; i++) {
+    llvm::Type *varType = logger.getVarAlloca(outer[i])->getAllocatedType();
+    parameterNames.push_back(logger.getVarName(outer[i]));
+    // if var is pointer, leave it as it is
+    if (varType->isPointerTy())
+      parameterTypes.push_back(varType);
+    // else, we need to pass a reference to it as parameter
+    else
+      parameterTypes.push_back(varType->getPointerTo());
+  }
+
+  llvm::FunctionType *FT = llvm::FunctionType::get(retType, parameterTypes, false);
+  llvm::Function *F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, Fname, TheModule.get());
+  logger.addFunction(F);
+
+  // step 2: set all param names
+  unsigned Idx = 0;
+  for (auto &arg : F->args()) arg.setName(parameterNames[Idx++]->text);
+
+  llvm::BasicBlock *BB = llvm::BasicBlock::Create(TheContext, "entry", F);
+  Builder.SetInsertPoint(BB);
+  logger.openScope(BB);
+
+  // step 3: create allocas for params, in slots 0, 1, ...
+  Idx = 0;
+  for (auto &arg : F->args()) {
+    auto *alloca = Builder.CreateAlloca(arg.getType(), nullptr, arg.getName().str());
+    Builder.CreateStore(&arg, alloca);
+    logger.addVariable(Idx, parameterNames[Idx], alloca);
+    Idx++;
+  }
+  return F;
+}
+
+// the last steps of a function: a return in case its body has none
+// at the end, and verification
+static void closeFunction(llvm::Function *F) {
+  // step 6: check for return
+  llvm::Type *retType = F->getReturnType();
+  if (retType->isIntegerTy(32)) Builder.CreateRet(c32(0));
+  else if (retType->isIntegerTy(8)) Builder.CreateRet(c8(0));
+  else Builder.CreateRetVoid();
+
+  // step 7: verify, done
+  llvm::verifyFunction(*F);
+}
+
+/* ---------------------------------------------------------------------
+   ------- --single-pass: the same IR, generated from within sem() ------
+   ---------------------------------------------------------------------
+   sem() gives out the slots of a function as it goes, so the scopelog
+   is filled in the same order as by codegen()
+ ----------------------------------------------------------------------- */
+
+static thread_local llvm::Function *programFunction;
+
+void singlePassBegin() {
+  programFunction = nullptr;
+  MemScope scope(MEM_LLVM);
+  openModule();
+}
+
+void singlePassFunction(ASTFdecl *fdecl) {
+  if (sem_failed) return;
+  MemScope scope(MEM_LLVM);
+  openFunction(fdecl);
+}
+
+void singlePassVariable(ASTVdef *vdef) {
+  if (sem_failed) return;
+  MemScope scope(MEM_LLVM);
+  vdef->codegen();
+}
+
+void singlePassStatement(ASTNode *stmt) {
+  if (sem_failed) return;
+  MemScope scope(MEM_LLVM);
+  stmt->codegen();
+}
+
+// ASTFdef::codegen() steps 6 and 7
+void singlePassFunctionEnd() {
+  if (sem_failed) return;
+  MemScope scope(MEM_LLVM);
+  llvm::Function *F = logger.getEntry()->getParent();
+  closeFunction(F);
   logger.closeScope();
+  if (logger.empty()) programFunction = F;
+  else Builder.SetInsertPoint(logger.getEntry());
+}
+
+// codegen() steps 5 to 8; or, if sem failed, the module is thrown away
+// half done
+void singlePassEnd() {
+  if (sem_failed) {
+    TheModule.reset();
+    return;
+  }
+  callProgram(programFunction);
+  if (memReporting) memPhase(PHASE_DRIVER);
+  finishModule();
+}
 
-  // emit LLVM IR to stdout
-  TheModule->print(llvm::outs(), nullptr);
-  return;
+void resetCodegen() {
+  logger = Logger();
+  programFunction = nullptr;
+  singlePass = false;
+  TheModule.reset();
+
+  // and a new context: the old one would keep every type and constant
+  // ever made in it, for as long as the thread lives
+  Builder.~IRBuilder();
+  TheContext.~LLVMContext();
+  new (&TheContext) llvm::LLVMContext();
+  new (&Builder) llvm::IRBuilder<>(TheContext);
+  i8 = llvm::IntegerType::get(TheContext, 8);
+  i32 = llvm::IntegerType::get(TheContext, 32);
+  proc = llvm::Type::getVoidTy(TheContext);
 }
 
 /* ---------------------------------------------------------------------
    --------------- codegen() method: IR code generation ----------------
    --------------------------------------------------------------------- */
 
+// codegen() of whatever class this node is
+llvm::Value * ASTNode::codegen() {
+  switch (nodeKind) {
+    case AST_ID:         return static_cast<ASTId *>(this)->codegen();
+    case AST_INT:        return static_cast<ASTInt *>(this)->codegen();
+    case AST_CHAR:       return static_cast<ASTChar *>(this)->codegen();
+    case AST_STRING:     return static_cast<ASTString *>(this)->codegen();
+    case AST_VDEF:       return static_cast<ASTVdef *>(this)->codegen();
+    case AST_SEQ:        return static_cast<ASTSeq *>(this)->codegen();
+    case AST_FDEF:       return static_cast<ASTFdef *>(this)->codegen();
+    case AST_FDECL:      return static_cast<ASTFdecl *>(this)->codegen();
+    case AST_PAR:        return static_cast<ASTPar *>(this)->codegen();
+    case AST_ASSIGN:     return static_cast<ASTAssign *>(this)->codegen();
+    case AST_FCALL:      return static_cast<ASTFcall *>(this)->codegen();
+    case AST_FCALL_STMT: return static_cast<ASTFcall_stmt *>(this)->codegen();
+    case AST_IF:         return static_cast<ASTIf *>(this)->codegen();
+    case AST_IFELSE:     return static_cast<ASTIfelse *>(this)->codegen();
+    case AST_WHILE:      return static_cast<ASTWhile *>(this)->codegen();
+    case AST_RET:        return static_cast<ASTRet *>(this)->codegen();
+    case AST_OP:         return static_cast<ASTOp *>(this)->codegen();
+  }
+  return nullptr;
+}
+
 // codegen() method of ASTId nodes
 llvm::Value * ASTId::codegen() {
   // load from the stack slot
@@ -142,80 +358,31 @@ llvm::Value * ASTInt::codegen() {
 
 // codegen() method of ASTChar nodes
 llvm::Value * ASTChar::codegen() {
-  return c8(this->id[0]);
+  return c8(this->c);
 }
 
 // codegen() method of ASTString nodes
 llvm::Value * ASTString::codegen() {
-  return Builder.CreateGlobalStringPtr(this->id.c_str());
+  return Builder.CreateGlobalStringPtr(this->id->text);
 }
 
 // codegen() method of ASTVdef nodes
 llvm::Value * ASTVdef::codegen() {
   auto *vtype = type_to_llvm(this->type);
-  auto *valloca = Builder.CreateAlloca(vtype, nullptr, this->id);
+  auto *valloca = Builder.CreateAlloca(vtype, nullptr, this->id->text);
   // log variable to be able to retrieve it later
-  logger.addVariable(this->id, vtype, valloca);
+  logger.addVariable(this->slot, this->id, valloca);
   return nullptr;
 }
 
-// codegen() method of ASTFdef nodes
+// codegen() method of ASTFdef nodes: the function
 llvm::Value * ASTFdef::codegen() {
-  auto *params = this->left->left;
   auto *locdefs = this->left->right;
-  string Fname = this->left->id;
-  llvm::Type *retType = type_to_llvm(this->left->type);
-  vector<string> parameterNames;
-  vector<llvm::Type *> parameterTypes;
-  vector<string> outerScopeVarsNames;
-  unordered_map<string, llvm::Type*> outerScopeVarsTypes;
-  unordered_map<string, llvm::AllocaInst*> outerScopeVarsAllocas;
-
-  // step 1a: log param types and names
-  while (params != nullptr) {
-    parameterNames.push_back(params->left->id);
-    parameterTypes.push_back(type_to_llvm(params->left->type, params->left->pm));
-    params = params->right;
-  }
-
-  // step 1b: add references to outer scope variables as parameters
-  outerScopeVarsTypes = logger.getCurrentScopeVarTypes();
-  outerScopeVarsAllocas = logger.getCurrentScopeVarAllocas();
-  for (auto var: outerScopeVarsTypes) outerScopeVarsNames.push_back(var.first);
-
-  llvm::Type *varType;
-  for (string var : outerScopeVarsNames) {
-    // skip shadowed outer scope variables
-    if (find(parameterNames.begin(), parameterNames.end(), var) != parameterNames.end()) continue;
-    varType = outerScopeVarsTypes[var];
-    parameterNames.push_back(var);
-    // if var is pointer, leave it as it is
-    if (varType->isPointerTy())
-     	parameterTypes.push_back(varType);
-    // else, we need to pass a reference to it as parameter
-    else
-    	parameterTypes.push_back(varType->getPointerTo());
-  }
+  TraceScope scope("CodegenFunction", this->left->name()->text);
 
-  llvm::FunctionType *FT = llvm::FunctionType::get(retType, parameterTypes, false);
-  llvm::Function *F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, Fname, TheModule.get());
-
-  logger.addFunctionInScope(Fname, F);
-  logger.openScope();
-
-  // step 2: set all param names
-  unsigned Idx = 0;
-  for (auto &arg : F->args()) arg.setName(parameterNames[Idx++]);
-
-  llvm::BasicBlock *BB = llvm::BasicBlock::Create(TheContext, "entry", F);
-  Builder.SetInsertPoint(BB);
-
-  // step 3: create allocas for params
-  for (auto &arg : F->args()) {
-    auto *alloca = Builder.CreateAlloca(arg.getType(), nullptr, arg.getName().str());
-    Builder.CreateStore(&arg, alloca);
-    logger.addVariable(arg.getName().str(), arg.getType(), alloca);
-  }
+  // steps 1 to 3: the function and its parameters
+  llvm::Function *F = openFunction(static_cast<ASTFdecl *>(this->left));
+  llvm::BasicBlock *BB = logger.getEntry();
 
   // step 4: codegen local defs
   while (locdefs != nullptr) {
@@ -228,16 +395,10 @@ llvm::Value * ASTFdef::codegen() {
   if (this->right != nullptr)
   	this->right->codegen();
 
-  // step 6: check for return
-  retType = F->getReturnType();
-  if (retType->isIntegerTy(32)) Builder.CreateRet(c32(0));
-  else if (retType->isIntegerTy(8)) Builder.CreateRet(c8(0));
-  else Builder.CreateRetVoid();
-
-  // step 7: verify, done
-  llvm::verifyFunction(*F);
+  // steps 6 and 7: return and verify
+  closeFunction(F);
   logger.closeScope();
-  return nullptr;
+  return F;
 }
 
 // codegen() method of ASTFdecl nodes
@@ -249,50 +410,42 @@ llvm::Value * ASTPar::codegen() { return nullptr; }
 // codegen() method of ASTAssign nodes
 llvm::Value * ASTAssign::codegen() {
 	auto *expr = this->right->codegen();
-	auto *addr = calcAddr(this->left, "AS");
+	// an ASTId: sem() allows nothing else on the left
+	auto *addr = calcAddr(static_cast<ASTId *>(this->left), "AS");
 	// store expression to the stack slot
 	return Builder.CreateStore(expr, addr);
 }
 
 // codegen() method of ASTFcall nodes
 llvm::Value * ASTFcall::codegen() {
-	llvm::Function *F = logger.getFunctionInScope(this->id);
+	llvm::Function *F = logger.getFunction(this->function);
 	vector<llvm::Value*> argv;
 	auto *ASTargs = this->left;
+	auto Arg = F->arg_begin();
 
-	// loop through parameters
-	for (auto &Arg : F->args()) {
-
-	    llvm::Value *arg;
-	    // function with no parameters, only outer scope ones
-	    if (ASTargs == nullptr) {
-	      argv.push_back(deref(logger.getVarAlloca(Arg.getName().str())));
-	      continue;
-	    }
-	    
+	// loop through the real parameters
+	for (; ASTargs != nullptr && ASTargs->left != nullptr; ASTargs = ASTargs->right, ++Arg) {
 	    auto *ASTarg = ASTargs->left;
-
-	    // check if done with real parameters (outer scope vars left)
-	    if (ASTarg == nullptr) {
-	      argv.push_back(deref(logger.getVarAlloca(Arg.getName().str())));
-	      continue;
-	    }
+	    llvm::Value *arg;
 
 	    // If expected argument is by value
-	 		if (!Arg.getType()->isPointerTy())
+	 		if (!Arg->getType()->isPointerTy())
 			    arg = ASTarg->codegen();
 	 		else {
 				// string literal
-				if (ASTarg->op == STRING)
+				if (ASTarg->nodeKind == AST_STRING)
 					arg = ASTarg->codegen();
-				// variable
+				// variable: sem() allows nothing else by reference
 				else
-					arg = calcAddr(ASTarg, "ID");
+					arg = calcAddr(static_cast<ASTId *>(ASTarg), "ID");
 	 		}
 	    argv.push_back(arg);
-	    if (ASTargs->left != nullptr) ASTargs = ASTargs->right;
 	}
 
+	// then the outer scope variables it takes, from the slots sem() found
+	for (int i = 1; this->outer != nullptr && i <= this->outer[0]; i++)
+	  argv.push_back(deref(logger.getVarAlloca(this->outer[i])));
+
 	return Builder.CreateCall(F, argv);
 }
 
@@ -311,10 +464,8 @@ llvm::Value * ASTIf::codegen() {
 
   // emit then block
   Builder.SetInsertPoint(ThenBB);
-  logger.openScope();
   if (this->right) this->right->codegen();
   Builder.CreateBr(MergeBB);
-  logger.closeScope();
 
   // change Insert Point
   Builder.SetInsertPoint(MergeBB);
@@ -332,17 +483,13 @@ llvm::Value * ASTIfelse::codegen() {
 
   // emit then block
   Builder.SetInsertPoint(ThenBB);
-  logger.openScope();
   if (this->left->right) this->left->right->codegen();
   Builder.CreateBr(MergeBB);
-  logger.closeScope();
   
   // emit else block
   Builder.SetInsertPoint(ElseBB);
-  logger.openScope();
   if (this->right) this->right->codegen();
   Builder.CreateBr(MergeBB);
-  logger.closeScope();
 
   // change Insert Point
   Builder.SetInsertPoint(MergeBB);
@@ -381,9 +528,12 @@ llvm::Value * ASTRet::codegen() {
 }
 
 // codegen() method of ASTSeq nodes
+// (down the chain in a loop, as in ASTSeq::sem())
 llvm::Value * ASTSeq::codegen() {
-  if (this->left) this->left->codegen();
-  if (this->right) this->right->codegen();
+  ASTNode *seq = this;
+  for (; seq && seq->nodeKind == AST_SEQ; seq = seq->right)
+    if (seq->left) seq->left->codegen();
+  if (seq) seq->codegen();
   return nullptr;
 }
 
@@ -406,7 +556,7 @@ llvm::Value * ASTOp::codegen() {
     // create list of all operands
   	std::list<ASTNode *> ops;
   	ASTNode *it = this;
-  	while (it->op == op_kind) {
+  	while (it->nodeKind == AST_OP && it->op == op_kind) {
   		ops.push_front(it->right);
   		it = it->left;
   	}
@@ -552,5 +702,6 @@ void createstdlib() {
     FT = llvm::FunctionType::get(proc, vector<llvm::Type *>{i8->getPointerTo(), i8->getPointerTo()}, false);
     libFunctions.push_back(llvm::Function::Create(FT, llvm::Function::ExternalLinkage, "strcat", TheModule.get()));
 
-    for (auto F: libFunctions) logger.addFunctionInScope(F->getName().str(), F);
+    // numbers 0, 1, ... (as initLibFunctions() declares them)
+    for (auto F: libFunctions) logger.addFunction(F);
 }
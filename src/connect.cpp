@@ -0,0 +1,24 @@
+/* ---------------------------------------------------------------------
+   ---- bin/alan-connect: alan --connect without loading LLVM at all ---
+   --------------------------------------------------------------------- */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "server.hpp"
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: alan-connect socket [options] [infile]\n");
+    return 1;
+  }
+  const char *path = argv[1];
+  argv[1] = argv[0];
+  int status = request(path, argc - 1, argv + 1);
+  if (status < 0) {
+    fprintf(stderr, "alan-connect: cannot reach the compile server at %s: %s\n", path, strerror(errno));
+    return 1;
+  }
+  return status;
+}
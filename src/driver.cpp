@@ -0,0 +1,242 @@
+/* ---------------------------------------------------------------------
+   ------ ALANC - the Alan Limitless and Amazingly Neat Compiler -------
+   ---- the compiler driver: source -> IR -> object code -> executable --
+   --------------------------------------------------------------------- */
+
+#include <errno.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "general.hpp"
+#include "options.hpp"
+#include "compile.hpp"
+#include "cache.hpp"
+#include "emit.hpp"
+#include "memreport.hpp"
+#include "server.hpp"
+#include "source.hpp"
+#include "trace.hpp"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+
+extern char **environ;
+
+static std::string executable;   // the path of bin/alan itself
+static const char *tempObject;   // object file to link, removed on exit
+
+static void removeTempObject() {
+  if (tempObject != NULL) unlink(tempObject);
+}
+
+// name of an intermediate file next to the source (as alanc did)
+static const char *tempName(const char *suffix) {
+  std::string dir;
+  if (options.infile != NULL) dir = llvm::sys::path::parent_path(options.infile).str();
+  std::string name = std::string(filename) + suffix;
+  if (!dir.empty()) name = dir + "/" + name;
+  return strdup(name.c_str());
+}
+
+// write the contents of file name to stdout
+static void cat(const char *name) {
+  FILE *f = fopen(name, "r");
+  char buf[4096];
+  size_t n;
+  if (f == NULL) fatal("\rcannot open %s", name);
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) fwrite(buf, 1, n, stdout);
+  fclose(f);
+}
+
+// lib/libalanstd.a of the installation bin/alan belongs to
+static std::string runtimeLibrary() {
+  std::string prefix = llvm::sys::path::parent_path(llvm::sys::path::parent_path(executable)).str();
+  return prefix + "/lib/libalanstd.a";
+}
+
+// link obj with the Alan runtime library into options.outName
+// (the one step for which we still need another process)
+static int linkExecutable(const char *obj) {
+  std::string lib = runtimeLibrary();
+  const char *linker = getenv("CC");
+  if (linker == NULL || linker[0] == '\0') linker = "clang";
+
+  char *argv[] = {
+    (char *) linker, (char *) obj, (char *) lib.c_str(),
+    (char *) "-o", (char *) options.outName, NULL
+  };
+  pid_t pid;
+  int status;
+  if (posix_spawnp(&pid, linker, NULL, NULL, argv, environ) != 0) {
+    error("\rcannot run the linker %s", linker);
+    return 1;
+  }
+  if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    return 1;
+  return 0;
+}
+
+// compile (and link) options.infile into the outputs asked for
+static int build() {
+  if (options.memReport) memReportStart();
+  if (options.timeTrace != NULL) {
+    const char *path = options.timeTrace;
+    if (path[0] == '\0') path = strdup((std::string(filename) + ".json").c_str());
+    traceStart(path);
+  }
+  openSource(options.infile);
+
+  // step 1: decide which outputs the compiler must write; the backend
+  // runs at most once, however many of them there are
+  bool emitGiven = options.emitLl || options.emitBc || options.emitAsm || options.emitObj || options.emitAst;
+  bool linking = !emitGiven && !options.dumpIR && !options.dumpFinal && !options.noLink && !options.run;
+  const char *obj = NULL;
+
+  if (options.saveTemps) {
+    if (!options.emitLl) options.emitLl = tempName(".imm");
+    if (!options.emitAsm && !options.dumpIR) options.emitAsm = tempName(".asm");
+  }
+  if (options.dumpIR && !options.emitLl)
+    options.emitLl = "-";
+  else if (options.dumpFinal && !options.emitAsm)
+    options.emitAsm = "-";
+  else if (!emitGiven && !options.dumpIR && !options.dumpFinal && !options.run) {
+    if (linking) {
+      char temp[] = "/tmp/alanXXXXXX.o";
+      int fd = mkstemps(temp, 2);
+      if (fd < 0) fatal("\rcannot create a temporary object file");
+      close(fd);
+      obj = tempObject = strdup(temp);
+      atexit(removeTempObject);
+    }
+    else obj = strdup((std::string(filename) + ".o").c_str());
+    options.emitObj = obj;
+  }
+
+  // step 2: with --cache, a plain object or executable may have been
+  // built before, from the same source, with the same flags
+  const char *output = linking ? options.outName : obj;
+  std::string key;
+  if (options.cache && options.infile != NULL && output != NULL && !options.saveTemps) {
+    key = cacheKey(llvm::StringRef(sourceText, sourceLength), linking ? "exe" : "o", executable, runtimeLibrary());
+    if (cacheFetch(key, output)) return 0;
+  }
+
+  // step 3: source code to IR, assembly and/or object code (with --run,
+  // the program is executed in there and we never come back)
+  if (compile()) return 1;
+
+  // step 4: dump the stored IR or assembly if it was not written to stdout
+  if (options.dumpIR && strcmp(options.emitLl, "-")) cat(options.emitLl);
+  if (options.dumpFinal && strcmp(options.emitAsm, "-")) cat(options.emitAsm);
+
+  // step 5: link and create executable
+  if (linking && linkExecutable(obj)) return 1;
+  if (!key.empty()) cacheStore(key, output);
+  return 0;
+}
+
+/* ---------------------------------------------------------------------
+   -------- batch mode: alan -j N a.alan b.alan ... (one fork each) ----
+   --------------------------------------------------------------------- */
+
+typedef struct {
+  pid_t pid;
+  const char *infile;
+  FILE *log;            // stdout and stderr of the job
+} BatchJob;
+
+static BatchJob startJob(const char *infile) {
+  BatchJob job = { 0, infile, tmpfile() };
+  if (job.log == NULL) fatal("\rcannot create a temporary file");
+  fflush(NULL);
+  job.pid = fork();
+  if (job.pid < 0) fatal("\rcannot fork");
+  if (job.pid == 0) {
+    dup2(fileno(job.log), 1);
+    dup2(fileno(job.log), 2);
+    options.infile = infile;
+    filename = programName(infile);
+    options.outName = filename;
+    exit(build());
+  }
+  return job;
+}
+
+// print what the job said in one piece, so that jobs do not interleave
+static void finishJob(BatchJob &job, int status) {
+  char buf[4096];
+  size_t n;
+  rewind(job.log);
+  while ((n = fread(buf, 1, sizeof(buf), job.log)) > 0) fwrite(buf, 1, n, stderr);
+  fclose(job.log);
+  if (WIFSIGNALED(status))
+    error("\r%s: the compiler was killed by signal %d", job.infile, WTERMSIG(status));
+  fflush(stderr);
+}
+
+static int batch() {
+  // the outputs are named after the programs, so these must differ
+  std::set<std::string> names;
+  for (int i = 0; i < options.numInfiles; i++)
+    if (!names.insert(programName(options.infiles[i])).second)
+      fatal("\rtwo infiles are named %s", programName(options.infiles[i]));
+
+  // the warm state every job starts from (as in the compile server)
+  initTargets();
+  prepareCompiler();
+
+  std::vector<BatchJob> running;
+  int next = 0, failed = 0, status;
+  while (next < options.numInfiles || !running.empty()) {
+    while (next < options.numInfiles && (int) running.size() < options.jobs)
+      running.push_back(startJob(options.infiles[next++]));
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) internal("\rlost track of the compile jobs");
+    for (size_t i = 0; i < running.size(); i++)
+      if (running[i].pid == pid) {
+        finishJob(running[i], status);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed++;
+        running.erase(running.begin() + i);
+        break;
+      }
+  }
+  if (failed > 0)
+    fprintf(stderr, "%d of %d programs failed to compile\n", failed, options.numInfiles);
+  return failed > 0;
+}
+
+// one invocation of the compiler, given its command line
+static int driver(int argc, char *argv[]) {
+  parseOptions(argc, argv);
+  if (options.numInfiles > 1) return batch();
+  return build();
+}
+
+int main(int argc, char *argv[]) {
+  static int here;
+  executable = llvm::sys::fs::getMainExecutable(argv[0], &here);
+
+  // alan --server socket: compile for clients, in a warm process
+  if (argc > 1 && !strcmp(argv[1], "--server")) {
+    if (argc != 3) fatal("\rusage: alan --server socket");
+    return serve(argv[2], driver);
+  }
+  // alan --connect socket [options] [infile]: let the server compile
+  if (argc > 1 && !strcmp(argv[1], "--connect")) {
+    if (argc < 3) fatal("\rusage: alan --connect socket [options] [infile]");
+    const char *path = argv[2];
+    argv[2] = argv[0];
+    int status = request(path, argc - 2, argv + 2);
+    if (status < 0)
+      fatal("\rcannot reach the compile server at %s: %s", path, strerror(errno));
+    return status;
+  }
+  return driver(argc, argv);
+}
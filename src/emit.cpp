@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "general.hpp"
+#include "options.hpp"
+#include "emit.hpp"
+#include "memreport.hpp"
+#include "trace.hpp"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/MC/MCAsmBackend.h>
+#include <llvm/MC/MCAsmInfo.h>
+#include <llvm/MC/MCCodeEmitter.h>
+#include <llvm/MC/MCContext.h>
+#include <llvm/MC/MCObjectFileInfo.h>
+#include <llvm/MC/MCObjectWriter.h>
+#include <llvm/MC/MCParser/MCAsmParser.h>
+#include <llvm/MC/MCParser/MCTargetAsmParser.h>
+#include <llvm/MC/MCStreamer.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetOptions.h>
+#if LLVM_VERSION_MAJOR >= 14
+#include <llvm/MC/TargetRegistry.h>
+#else
+#include <llvm/Support/TargetRegistry.h>
+#endif
+
+#if LLVM_VERSION_MAJOR >= 10
+static const llvm::CodeGenFileType AssemblyFile = llvm::CGFT_AssemblyFile;
+static const llvm::CodeGenFileType ObjectFile   = llvm::CGFT_ObjectFile;
+#else
+static const llvm::TargetMachine::CodeGenFileType AssemblyFile = llvm::TargetMachine::CGFT_AssemblyFile;
+static const llvm::TargetMachine::CodeGenFileType ObjectFile   = llvm::TargetMachine::CGFT_ObjectFile;
+#endif
+
+// translate our optimization level to the one of the backend (as llc -O)
+static llvm::CodeGenOpt::Level backendLevel(OptLevel level) {
+  switch (level) {
+    case OPT_O0: return llvm::CodeGenOpt::None;
+    case OPT_O1: return llvm::CodeGenOpt::Less;
+    case OPT_O3: return llvm::CodeGenOpt::Aggressive;
+    default:     return llvm::CodeGenOpt::Default;
+  }
+}
+
+std::string hostFeatures() {
+  llvm::StringMap<bool> features;
+  std::vector<std::string> sorted;
+  std::string attrs;
+  if (!llvm::sys::getHostCPUFeatures(features)) return attrs;
+  for (auto &f : features) sorted.push_back((f.second ? "+" : "-") + f.first().str());
+  std::sort(sorted.begin(), sorted.end());
+  for (auto &f : sorted) {
+    if (!attrs.empty()) attrs += ",";
+    attrs += f;
+  }
+  return attrs;
+}
+
+void initTargets() {
+  static bool done = [] {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    llvm::InitializeNativeTargetAsmParser();
+    return true;
+  }();
+  (void) done;
+}
+
+llvm::TargetMachine *targetMachine(llvm::Module &M) {
+  initTargets();
+
+  std::string triple = llvm::sys::getDefaultTargetTriple();
+  std::string err;
+  const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple, err);
+  if (!target)
+    internal("\rno target for %s: %s", triple.c_str(), err.c_str());
+
+  std::string cpu = options.cpu ? options.cpu : "generic";
+  if (cpu == "native") cpu = llvm::sys::getHostCPUName().str();
+  std::string features = options.features ? options.features : "";
+  if (features == "native") features = hostFeatures();
+
+  llvm::TargetMachine *TM = target->createTargetMachine(
+    triple, cpu, features, llvm::TargetOptions(),
+    llvm::Reloc::PIC_, llvm::None, backendLevel(options.optLevel)
+  );
+  if (!TM)
+    internal("\rcannot create a target machine for %s", triple.c_str());
+
+  M.setTargetTriple(triple);
+  M.setDataLayout(TM->createDataLayout());
+  return TM;
+}
+
+/* ---------------------------------------------------------------------
+   ---------------------------- output files ---------------------------
+   --------------------------------------------------------------------- */
+
+thread_local EmitBuffers *emitBuffers = nullptr;
+
+// open name for writing ("-" is stdout), or buffer in its place if
+// there is one (of emitBuffers)
+static std::unique_ptr<llvm::raw_ostream> openOutput(const char *name, std::string *buffer) {
+  if (buffer)
+    return std::unique_ptr<llvm::raw_ostream>(new llvm::raw_string_ostream(*buffer));
+  std::error_code ec;
+  std::unique_ptr<llvm::raw_fd_ostream> out(new llvm::raw_fd_ostream(name, ec, llvm::sys::fs::OF_None));
+  if (ec)
+    fatal("\rcannot open %s: %s", name, ec.message().c_str());
+  return out;
+}
+
+static void writeOutput(const char *name, std::string *buffer, llvm::StringRef data) {
+  *openOutput(name, buffer) << data;
+}
+
+// assemble the output of the backend in-process (as clang -save-temps
+// does), so that asking for both assembly and object code costs one
+// instruction selection instead of two
+static void assemble(llvm::StringRef text, llvm::TargetMachine *TM,
+                     llvm::SmallVectorImpl<char> &obj) {
+  TraceScope scope("Assemble");
+  const llvm::Target &target = TM->getTarget();
+  const llvm::Triple &triple = TM->getTargetTriple();
+  const llvm::MCAsmInfo *MAI = TM->getMCAsmInfo();
+  const llvm::MCRegisterInfo *MRI = TM->getMCRegisterInfo();
+  const llvm::MCInstrInfo *MII = TM->getMCInstrInfo();
+  const llvm::MCSubtargetInfo *STI = TM->getMCSubtargetInfo();
+  llvm::MCTargetOptions MCOptions = TM->Options.MCOptions;
+
+  llvm::SourceMgr SrcMgr;
+  SrcMgr.AddNewSourceBuffer(llvm::MemoryBuffer::getMemBuffer(text, "", false), llvm::SMLoc());
+#if LLVM_VERSION_MAJOR >= 13
+  llvm::MCContext Ctx(triple, MAI, MRI, STI, &SrcMgr);
+  std::unique_ptr<llvm::MCObjectFileInfo> MOFI(target.createMCObjectFileInfo(Ctx, true));
+  Ctx.setObjectFileInfo(MOFI.get());
+#else
+  llvm::MCObjectFileInfo MOFI;
+  llvm::MCContext Ctx(MAI, MRI, &MOFI, &SrcMgr);
+  MOFI.InitMCObjectFileInfo(triple, true, Ctx);
+#endif
+
+  llvm::raw_svector_ostream out(obj);
+  llvm::MCAsmBackend *MAB = target.createMCAsmBackend(*STI, *MRI, MCOptions);
+  llvm::MCCodeEmitter *CE = target.createMCCodeEmitter(*MII, *MRI, Ctx);
+  std::unique_ptr<llvm::MCStreamer> streamer(target.createMCObjectStreamer(
+    triple, Ctx, std::unique_ptr<llvm::MCAsmBackend>(MAB), MAB->createObjectWriter(out),
+    std::unique_ptr<llvm::MCCodeEmitter>(CE), *STI, MCOptions.MCRelaxAll,
+    MCOptions.MCIncrementalLinkerCompatible, false
+  ));
+
+  std::unique_ptr<llvm::MCAsmParser> parser(llvm::createMCAsmParser(SrcMgr, Ctx, *streamer, *MAI));
+  std::unique_ptr<llvm::MCTargetAsmParser> targetParser(
+    target.createMCAsmParser(*STI, *parser, *MII, MCOptions)
+  );
+  parser->setTargetParser(*targetParser);
+  if (parser->Run(false))
+    internal("\rcannot assemble the generated code");
+}
+
+/* ---------------------------------------------------------------------
+   -------------------------- THE EMIT FUNCTION ------------------------
+   --------------------------------------------------------------------- */
+
+void emit(llvm::Module &M, llvm::TargetMachine *TM, llvm::SmallVectorImpl<char> *obj) {
+  TraceScope scope("Emit");
+  MemPhaseScope phase(PHASE_EMIT);
+
+  // LLVM IR
+  EmitBuffers *buffers = emitBuffers;
+  if (options.emitLl)
+    M.print(*openOutput(options.emitLl, buffers ? &buffers->ll : nullptr), nullptr);
+
+  // bitcode
+  if (options.emitBc)
+    llvm::WriteBitcodeToFile(M, *openOutput(options.emitBc, buffers ? &buffers->bc : nullptr));
+
+  bool wantObj = options.emitObj || obj;
+  if (!options.emitAsm && !wantObj) return;
+
+  // one run of the backend: assembly if it was asked for, else object code
+  llvm::SmallString<0> code;
+  llvm::raw_svector_ostream out(code);
+  llvm::legacy::PassManager PM;
+  if (TM->addPassesToEmitFile(PM, out, nullptr, options.emitAsm ? AssemblyFile : ObjectFile))
+    internal("\rtarget cannot emit %s", options.emitAsm ? "assembly" : "object code");
+  {
+    TraceScope backend("Backend", options.emitAsm ? "assembly" : "object code");
+    PM.run(M);
+  }
+
+  if (options.emitAsm)
+    writeOutput(options.emitAsm, buffers ? &buffers->assembly : nullptr, code);
+  if (!wantObj) return;
+
+  llvm::SmallString<0> object;
+  if (options.emitAsm)
+    assemble(code, TM, object);
+  else
+    object.swap(code);
+  if (options.emitObj)
+    writeOutput(options.emitObj, buffers ? &buffers->object : nullptr, object);
+  if (obj)
+    obj->assign(object.begin(), object.end());
+}
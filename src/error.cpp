@@ -41,36 +41,74 @@
    ---------       ----------
    --------------------------------------------------------------------- */
 
-void internal (const char * fmt, ...)
+thread_local void (*diagnosticSink)(DiagKind kind, int line, const char * message) = NULL;
+thread_local jmp_buf * fatalReturn = NULL;
+
+static const char * const labels [] = {
+   ANSI_COLOR_YELLOW "Warning",
+   ANSI_COLOR_RED "Error",
+   ANSI_COLOR_RED "Fatal error",
+   ANSI_COLOR_RED "Internal error"
+};
+
+/* A format that starts with '\r' is not about the current line. */
+
+static void report (DiagKind kind, const char * fmt, va_list ap)
 {
-   va_list ap;
+   int line = linecount;
 
-   va_start(ap, fmt);
-   if (fmt[0] == '\r')
+   if (fmt[0] == '\r') {
       fmt++;
-   else
-      fprintf(stderr, "%s:%d: ", filename, linecount);
-   fprintf(stderr, ANSI_COLOR_RED "Internal error%s, ", ANSI_COLOR_RESET);
+      line = 0;
+   }
+   if (diagnosticSink != NULL) {
+      va_list aq;
+
+      va_copy(aq, ap);
+      int length = vsnprintf(NULL, 0, fmt, aq);
+      va_end(aq);
+      char * message = (char *) malloc(length + 1);
+      if (message == NULL)
+         return;
+      vsnprintf(message, length + 1, fmt, ap);
+      while (length > 0 && message[length - 1] == '\n')
+         message[--length] = '\0';
+      diagnosticSink(kind, line, message);
+      free(message);
+      return;
+   }
+   if (line != 0)
+      fprintf(stderr, "%s:%d: ", filename, line);
+   fprintf(stderr, "%s%s, ", labels[kind], ANSI_COLOR_RESET);
    vfprintf(stderr, fmt, ap);
    fprintf(stderr, "\n");
-   va_end(ap);
+}
+
+static void stop (void)
+{
+   if (fatalReturn != NULL)
+      longjmp(*fatalReturn, 1);
    exit(1);
 }
 
+void internal (const char * fmt, ...)
+{
+   va_list ap;
+
+   va_start(ap, fmt);
+   report(DIAG_INTERNAL, fmt, ap);
+   va_end(ap);
+   stop();
+}
+
 void fatal (const char * fmt, ...)
 {
    va_list ap;
 
    va_start(ap, fmt);
-   if (fmt[0] == '\r')
-      fmt++;
-   else
-      fprintf(stderr, "%s:%d: ", filename, linecount);
-   fprintf(stderr, ANSI_COLOR_RED "Fatal error%s, ", ANSI_COLOR_RESET);
-   vfprintf(stderr, fmt, ap);
-   fprintf(stderr, "\n");
+   report(DIAG_FATAL, fmt, ap);
    va_end(ap);
-   exit(1);
+   stop();
 }
 
 void error (const char * fmt, ...)
@@ -78,13 +116,7 @@ void error (const char * fmt, ...)
    va_list ap;
 
    va_start(ap, fmt);
-   if (fmt[0] == '\r')
-      fmt++;
-   else
-      fprintf(stderr, "%s:%d: ", filename, linecount);
-   fprintf(stderr, ANSI_COLOR_RED "Error%s, ", ANSI_COLOR_RESET);
-   vfprintf(stderr, fmt, ap);
-   fprintf(stderr, "\n");
+   report(DIAG_ERROR, fmt, ap);
    va_end(ap);
    sem_failed = 1;
 }
@@ -94,12 +126,6 @@ void warning (const char * fmt, ...)
    va_list ap;
 
    va_start(ap, fmt);
-   if (fmt[0] == '\r')
-      fmt++;
-   else
-      fprintf(stderr, "%s:%d: ", filename, linecount);
-   fprintf(stderr, ANSI_COLOR_YELLOW "Warning%s, ", ANSI_COLOR_RESET);
-   vfprintf(stderr, fmt, ap);
-   fprintf(stderr, "\n");
+   report(DIAG_WARNING, fmt, ap);
    va_end(ap);
 }
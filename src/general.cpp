@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "general.hpp"
+#include "memreport.hpp"
 
 /* ---------------------------------------------------------------------
    ----------- Õëïðïßçóç ôùí óõíáñôÞóåùí äéá÷åßñéóçò ìíÞìçò ------------
@@ -34,6 +35,7 @@
 void * mynew (size_t size) {
    void * result = malloc(size);
    
+   memCount(size);
    if (result == NULL)
       fatal("\rOut of memory");
    return result;
@@ -44,6 +46,10 @@ void mydelete (void * p) {
       free(p);
 }
 
+char * mystrdup (const char * s) {
+   return strcpy((char *) mynew(strlen(s) + 1), s);
+}
+
 char escapeChar(char *s) {
   switch (s[2]) {
     case 'n':  return '\n';
@@ -54,9 +60,10 @@ char escapeChar(char *s) {
     case '\'': return '\'';
     case '\"': return '\"';
     case 'x': {
-      char hex[2];
+      char hex[3];
       hex[0] = s[3];
       hex[1] = s[4];
+      hex[2] = '\0';
       return (char)strtol(hex, NULL, 16);
     }
     default: internal("read garbage from lexer");
@@ -65,18 +72,19 @@ char escapeChar(char *s) {
   return -1;
 }
 
-char *escapeString(char *s) {
-  int N = strlen(s)+1; // includes trailing '\0'
+// the bytes of the string literal s[0..length) (quotes included), with
+// its escapes decoded; like the C string it used to be, it ends at \0
+std::string escapeString(const char *s, int length) {
   char curr;
   char to_escape[5] = {'\'', '\\', '\0', '\0', '\0'};
-  char *escaped = (char *)malloc(N*sizeof(char));
+  std::string escaped;
   int i = 1;
-  int j = 0;
-  while (i < N-1) {
+  escaped.reserve(length);
+  while (i < length) {
     curr = s[i];
     /* curr is not the beginning of an escape sequence */
     if (curr != '\\') {
-      escaped[j++] = curr;
+      escaped += curr;
     }
     /* curr is the beginning of an escape sequence */    
     else {
@@ -87,11 +95,12 @@ char *escapeString(char *s) {
         to_escape[4] = s[i];
       }
       else to_escape[2] = s[i];
-      escaped[j++] = escapeChar(to_escape);
+      escaped += escapeChar(to_escape);
     }
     i++;
   }
-  escaped[j-1] = '\0';
+  escaped.pop_back(); // the closing quote
+  escaped.resize(strlen(escaped.c_str()));
   return escaped;
 }
 
@@ -99,5 +108,5 @@ char *escapeString(char *s) {
    ------- Áñ÷åßï åéóüäïõ ôïõ ìåôáãëùôôéóôÞ êáé áñéèìüò ãñáììÞò --------
    --------------------------------------------------------------------- */
 
-int linecount;
-int sem_failed = 0;
+thread_local int linecount;
+thread_local int sem_failed = 0;
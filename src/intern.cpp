@@ -0,0 +1,93 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "general.hpp"
+#include "intern.hpp"
+
+// open addressing, a power of two slots, at most half of them in use
+static thread_local Symbol *table;
+static thread_local unsigned slots, used;
+
+// names and their text come from chunks that are only freed all at
+// once, by forgetNames(); each one starts with a link to the one before
+static thread_local char *chunks;
+static thread_local char *chunk;
+static thread_local size_t chunkLeft;
+
+static void *allocate(size_t size) {
+  size = (size + 7) & ~(size_t) 7;
+  if (size > chunkLeft) {
+    size_t chunkSize = size > 65536 ? size : 65536;
+    char *c = (char *) mynew(sizeof(char *) + chunkSize);
+    *(char **) c = chunks;
+    chunks = c;
+    chunk = c + sizeof(char *);
+    chunkLeft = chunkSize;
+  }
+  void *p = chunk;
+  chunk += size;
+  chunkLeft -= size;
+  return p;
+}
+
+// FNV-1a
+static unsigned hashText(const char *text, int length) {
+  unsigned h = 2166136261u;
+  for (int i = 0; i < length; i++) {
+    h ^= (unsigned char) text[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static void grow() {
+  Symbol *old = table;
+  unsigned oldSlots = slots;
+  slots = slots ? 2 * slots : 1024;
+  table = (Symbol *) mynew(slots * sizeof(Symbol));
+  memset(table, 0, slots * sizeof(Symbol));
+  for (unsigned i = 0; i < oldSlots; i++)
+    if (old[i] != NULL) {
+      unsigned j = old[i]->hash & (slots - 1);
+      while (table[j] != NULL) j = (j + 1) & (slots - 1);
+      table[j] = old[i];
+    }
+  mydelete(old);
+}
+
+Symbol intern(const char *text, int length) {
+  if (2 * (used + 1) > slots) grow();
+  unsigned hash = hashText(text, length);
+  unsigned i = hash & (slots - 1);
+  for (; table[i] != NULL; i = (i + 1) & (slots - 1))
+    if (table[i]->hash == hash && table[i]->length == length &&
+        memcmp(table[i]->text, text, length) == 0)
+      return table[i];
+
+  char *copy = (char *) allocate(length + 1);
+  memcpy(copy, text, length);
+  copy[length] = '\0';
+  SymbolName *name = (SymbolName *) allocate(sizeof(SymbolName));
+  name->text = copy;
+  name->length = length;
+  name->hash = hash;
+  used++;
+  return table[i] = name;
+}
+
+Symbol intern(const char *text) {
+  return intern(text, strlen(text));
+}
+
+void forgetNames() {
+  while (chunks != NULL) {
+    char *next = *(char **) chunks;
+    mydelete(chunks);
+    chunks = next;
+  }
+  chunk = NULL;
+  chunkLeft = 0;
+  mydelete(table);
+  table = NULL;
+  slots = used = 0;
+}
@@ -0,0 +1,106 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory>
+#include <string>
+
+#include "general.hpp"
+#include "jit.hpp"
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/JITSymbol.h>
+#include <llvm/ExecutionEngine/Orc/Core.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/Mangling.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+/* ---------------------------------------------------------------------
+   ------- the runtime library, compiled into bin/alan (ALAN_HOSTED) ---
+   ---- with an alan_ prefix, so that strlen & co keep meaning libc's --
+   --------------------------------------------------------------------- */
+
+extern "C" {
+  void    alan_writeInteger(int32_t n);
+  void    alan_writeByte(uint8_t b);
+  void    alan_writeChar(uint8_t b);
+  void    alan_writeString(uint8_t *s);
+  int32_t alan_readInteger();
+  uint8_t alan_readByte();
+  uint8_t alan_readChar();
+  void    alan_readString(int32_t n, uint8_t *s);
+  int32_t alan_extend(uint8_t b);
+  uint8_t alan_shrink(int32_t i);
+  int32_t alan_strlen(uint8_t *s);
+  int32_t alan_strcmp(uint8_t *s1, uint8_t *s2);
+  void    alan_strcpy(uint8_t *trg, uint8_t *src);
+  void    alan_strcat(uint8_t *trg, uint8_t *src);
+}
+
+static const struct {
+  const char *name;
+  void *address;
+} runtime[] = {
+  { "writeInteger", (void *) alan_writeInteger },
+  { "writeByte",    (void *) alan_writeByte    },
+  { "writeChar",    (void *) alan_writeChar    },
+  { "writeString",  (void *) alan_writeString  },
+  { "readInteger",  (void *) alan_readInteger  },
+  { "readByte",     (void *) alan_readByte     },
+  { "readChar",     (void *) alan_readChar     },
+  { "readString",   (void *) alan_readString   },
+  { "extend",       (void *) alan_extend       },
+  { "shrink",       (void *) alan_shrink       },
+  { "strlen",       (void *) alan_strlen       },
+  { "strcmp",       (void *) alan_strcmp       },
+  { "strcpy",       (void *) alan_strcpy       },
+  { "strcat",       (void *) alan_strcat       }
+};
+
+// errors of the JIT are ours, not the program's
+static void check(llvm::Error err) {
+  if (err)
+    internal("\rJIT: %s", llvm::toString(std::move(err)).c_str());
+}
+
+template <typename T>
+static T check(llvm::Expected<T> value) {
+  if (!value)
+    internal("\rJIT: %s", llvm::toString(value.takeError()).c_str());
+  return std::move(*value);
+}
+
+/* ---------------------------------------------------------------------
+   --------------------------- THE RUN FUNCTION ------------------------
+   --------------------------------------------------------------------- */
+
+void run(llvm::StringRef obj) {
+  std::unique_ptr<llvm::orc::LLJIT> J = check(llvm::orc::LLJITBuilder().create());
+  llvm::orc::JITDylib &JD = J->getMainJITDylib();
+  const llvm::DataLayout &DL = J->getDataLayout();
+
+  // the runtime library first, whatever else the process has (e.g. the
+  // memcpy the backend may call) after that
+  llvm::orc::MangleAndInterner mangle(J->getExecutionSession(), DL);
+  llvm::orc::SymbolMap symbols;
+  for (auto &f : runtime)
+    symbols[mangle(f.name)] = llvm::JITEvaluatedSymbol(
+      llvm::pointerToJITTargetAddress(f.address), llvm::JITSymbolFlags::Exported
+    );
+  check(JD.define(llvm::orc::absoluteSymbols(symbols)));
+#if LLVM_VERSION_MAJOR >= 10
+  JD.addGenerator(check(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(DL.getGlobalPrefix())));
+#else
+  JD.setGenerator(check(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(DL.getGlobalPrefix())));
+#endif
+
+  check(J->addObjectFile(llvm::MemoryBuffer::getMemBufferCopy(obj, filename)));
+#if LLVM_VERSION_MAJOR >= 15
+  int (*programMain)() = check(J->lookup("main")).toPtr<int (*)()>();
+#else
+  int (*programMain)() = (int (*)()) check(J->lookup("main")).getAddress();
+#endif
+
+  exit(programMain());
+}
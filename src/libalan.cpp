@@ -0,0 +1,99 @@
+/* ---------------------------------------------------------------------
+   ---- libalan: compile() of bin/alan, run on a source in memory ------
+   ---- with the options of a request, its diagnostics collected and ---
+   ---- its outputs kept; the state of the compiler is thread_local, ---
+   ---- so every thread that calls alanCompile() has its own ----------
+   --------------------------------------------------------------------- */
+
+#include <setjmp.h>
+#include <string>
+
+#include "alan.hpp"
+#include "compile.hpp"
+#include "emit.hpp"
+#include "error.hpp"
+#include "general.hpp"
+#include "options.hpp"
+#include "source.hpp"
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+static_assert((int) ALAN_Oz == (int) OPT_Oz, "AlanOptLevel follows OptLevel");
+static_assert((int) ALAN_INTERNAL == (int) DIAG_INTERNAL, "AlanSeverity follows DiagKind");
+
+AlanResult::AlanResult() : ok(false) {}
+AlanResult::AlanResult(AlanResult &&) = default;
+AlanResult &AlanResult::operator=(AlanResult &&) = default;
+AlanResult::~AlanResult() = default;
+
+// where the diagnostics of the compilation of the thread go
+static thread_local std::vector<AlanDiagnostic> *diagnostics;
+
+static void collect(DiagKind kind, int line, const char *message) {
+  diagnostics->push_back({ (AlanSeverity) kind, line, message });
+}
+
+// the "file" of an output that is wanted: it goes to emitBuffers
+static const char WANTED[] = "";
+
+AlanResult alanCompile(const char *source, size_t length, const AlanRequest &request) {
+  AlanResult result;
+
+  // the source, followed by the padding the scanner reads
+  std::string text(source, length);
+  text.append(SOURCE_PADDING, '\0');
+  sourceText = &text[0];
+  sourceLength = length;
+  filename = request.name;
+
+  // the module is handed over as bitcode, read into the context given
+  bool wantModule = request.context != nullptr;
+  options = Options();
+  options.optLevel = (OptLevel) request.optLevel;
+  options.cpu = request.cpu;
+  options.features = request.features;
+  options.singlePass = request.singlePass;
+  options.emitLl = request.ll ? WANTED : nullptr;
+  options.emitBc = request.bc || wantModule ? WANTED : nullptr;
+  options.emitAsm = request.assembly ? WANTED : nullptr;
+  options.emitObj = request.object ? WANTED : nullptr;
+
+  EmitBuffers buffers;
+  emitBuffers = &buffers;
+  diagnostics = &result.diagnostics;
+  diagnosticSink = collect;
+  jmp_buf stop;
+  fatalReturn = &stop;
+  if (setjmp(stop) == 0)
+    result.ok = compile() == 0;
+  fatalReturn = nullptr;
+  diagnosticSink = nullptr;
+  diagnostics = nullptr;
+  emitBuffers = nullptr;
+  resetCompiler();
+  sourceText = nullptr;
+  sourceLength = 0;
+  filename = nullptr;
+  if (!result.ok) return result;
+
+  if (wantModule) {
+    llvm::MemoryBufferRef bitcode(buffers.bc, request.name);
+    llvm::Expected<std::unique_ptr<llvm::Module>> module =
+      llvm::parseBitcodeFile(bitcode, *request.context);
+    if (!module) {
+      result.ok = false;
+      result.diagnostics.push_back({ ALAN_INTERNAL, 0, "cannot read the module back: " +
+                                     llvm::toString(module.takeError()) });
+      return result;
+    }
+    result.module = std::move(*module);
+  }
+  result.ll.swap(buffers.ll);
+  if (request.bc) result.bc.swap(buffers.bc);
+  result.assembly.swap(buffers.assembly);
+  result.object.swap(buffers.object);
+  return result;
+}
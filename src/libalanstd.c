@@ -7,6 +7,25 @@
 #include <stdint.h>
 #include <inttypes.h>
 
+/* bin/alan --run hosts this library (built with -DALAN_HOSTED); the
+   prefix keeps our strlen & co from replacing those of libc in there */
+#ifdef ALAN_HOSTED
+#define writeInteger alan_writeInteger
+#define writeByte    alan_writeByte
+#define writeChar    alan_writeChar
+#define writeString  alan_writeString
+#define readInteger  alan_readInteger
+#define readByte     alan_readByte
+#define readChar     alan_readChar
+#define readString   alan_readString
+#define extend       alan_extend
+#define shrink       alan_shrink
+#define strlen       alan_strlen
+#define strcmp       alan_strcmp
+#define strcpy       alan_strcpy
+#define strcat       alan_strcat
+#endif
+
 /*** write functions ***/
 void writeInteger(int32_t n) {
     printf("%" PRId32, n);
@@ -0,0 +1,52 @@
+#include <stdlib.h>
+#include <new>
+
+#include "error.hpp"
+#include "memreport.hpp"
+
+/* ---------------------------------------------------------------------
+   ----- operator new of the whole process (LLVM's included), so -------
+   ----- that it is counted too; costs a test when not reporting; ------
+   ----- bin/alan only: libalan leaves the allocator to its host -------
+   --------------------------------------------------------------------- */
+
+static void *allocate(size_t size) {
+  void *p = malloc(size ? size : 1);
+  if (p != NULL) memCount(size);
+  return p;
+}
+
+// LLVM is built with -fno-exceptions, so there is no bad_alloc to
+// throw: the new handler gets its chances, then it is as in mynew()
+static void *allocateOrDie(size_t size) {
+  void *p;
+  while ((p = allocate(size)) == NULL) {
+    std::new_handler handler = std::get_new_handler();
+    if (handler == NULL) fatal("\rOut of memory");
+    handler();
+  }
+  return p;
+}
+
+void *operator new(size_t size) {
+  return allocateOrDie(size);
+}
+
+void *operator new[](size_t size) {
+  return allocateOrDie(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { free(p); }
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "general.hpp"
+#include "memreport.hpp"
+
+bool memReporting = false;
+
+typedef struct {
+  unsigned long count;
+  unsigned long long bytes;
+} Allocations;
+
+static const char *phaseNames[PHASE_COUNT] = {
+  "driver", "parse", "sem", "codegen", "optimize", "emit", "run"
+};
+
+static const char *subsystemNames[MEM_COUNT] = {
+  "AST", "symbol table", "types", "Logger", "LLVM module", "other"
+};
+
+// what a phase allocates unless a MemScope says otherwise
+static const MemSubsystem phaseSubsystem[PHASE_COUNT] = {
+  MEM_OTHER, MEM_AST, MEM_SYMBOLS, MEM_LLVM, MEM_LLVM, MEM_LLVM, MEM_LLVM
+};
+
+// plain arrays: operator new (memhook.cpp) must not allocate to count
+static Allocations allocations[PHASE_COUNT][MEM_COUNT];
+static long peakRSS[PHASE_COUNT];            // KiB, -1 if never entered
+static MemPhase phase = PHASE_DRIVER;
+static MemSubsystem subsystem = MEM_OTHER;
+static bool resettable = true;               // can the peak be reset?
+
+void memCount(size_t bytes) {
+  if (!memReporting) return;
+  Allocations &a = allocations[phase][subsystem];
+  a.count++;
+  a.bytes += bytes;
+}
+
+/* ---------------------------------------------------------------------
+   ------------------- peak RSS, from /proc/self/status ----------------
+   --------------------------------------------------------------------- */
+
+static long highWaterMark() {
+  FILE *f = fopen("/proc/self/status", "r");
+  char line[256];
+  long kb = 0;
+  if (f == NULL) return 0;
+  while (fgets(line, sizeof(line), f) != NULL)
+    if (!strncmp(line, "VmHWM:", 6)) {
+      kb = atol(line + 6);
+      break;
+    }
+  fclose(f);
+  return kb;
+}
+
+// start measuring the peak over again, from what is resident now
+// (linux >= 4.0; without it, each peak is the one since start-up)
+static void resetHighWaterMark() {
+  FILE *f = fopen("/proc/self/clear_refs", "w");
+  if (f == NULL || fputs("5", f) < 0) resettable = false;
+  if (f != NULL && fclose(f) != 0) resettable = false;
+}
+
+// the phase being left peaked at the current high water mark
+static void closePhase() {
+  long kb = highWaterMark();
+  if (kb > peakRSS[phase]) peakRSS[phase] = kb;
+  resetHighWaterMark();
+}
+
+MemPhase memPhase(MemPhase p) {
+  MemPhase outer = phase;
+  closePhase();
+  phase = p;
+  subsystem = phaseSubsystem[p];
+  return outer;
+}
+
+MemSubsystem memSubsystem(MemSubsystem s) {
+  MemSubsystem outer = subsystem;
+  subsystem = s;
+  return outer;
+}
+
+/* ---------------------------------------------------------------------
+   ------------------------------- output ------------------------------
+   --------------------------------------------------------------------- */
+
+static void printReport() {
+  closePhase();
+  memReporting = false;
+
+  fprintf(stderr, "memory report for %s%s\n", filename,
+          resettable ? "" : " (peaks are since start-up: cannot reset VmHWM)");
+  fprintf(stderr, "  %-12s %12s %12s %14s  %s\n", "phase", "peak RSS KiB", "allocations", "bytes", "mostly");
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    if (peakRSS[p] < 0) continue;
+    Allocations total = { 0, 0 };
+    int most = MEM_OTHER;
+    for (int s = 0; s < MEM_COUNT; s++) {
+      total.count += allocations[p][s].count;
+      total.bytes += allocations[p][s].bytes;
+      if (allocations[p][s].bytes > allocations[p][most].bytes) most = s;
+    }
+    fprintf(stderr, "  %-12s %12ld %12lu %14llu  %s\n", phaseNames[p], peakRSS[p],
+            total.count, total.bytes, total.bytes ? subsystemNames[most] : "-");
+  }
+
+  fprintf(stderr, "  %-12s %12s %12s %14s\n", "subsystem", "", "allocations", "bytes");
+  for (int s = 0; s < MEM_COUNT; s++) {
+    Allocations total = { 0, 0 };
+    for (int p = 0; p < PHASE_COUNT; p++) {
+      total.count += allocations[p][s].count;
+      total.bytes += allocations[p][s].bytes;
+    }
+    fprintf(stderr, "  %-12s %12s %12lu %14llu\n", subsystemNames[s], "", total.count, total.bytes);
+  }
+}
+
+void memReportStart() {
+  if (memReporting) return;
+  for (int p = 0; p < PHASE_COUNT; p++) peakRSS[p] = -1;
+  memReporting = true;
+  memPhase(PHASE_DRIVER);
+  atexit(printReport);
+}
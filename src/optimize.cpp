@@ -0,0 +1,250 @@
+#include <string>
+#include <vector>
+
+#include "general.hpp"
+#include "cache.hpp"
+#include "optimize.hpp"
+#include "memreport.hpp"
+#include "trace.hpp"
+
+#include <llvm/ADT/Any.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+
+#if LLVM_VERSION_MAJOR >= 14
+typedef llvm::OptimizationLevel PipelineLevel;
+#else
+typedef llvm::PassBuilder::OptimizationLevel PipelineLevel;
+#endif
+
+// translate our optimization level to the one of the PassBuilder
+static PipelineLevel pipelineLevel(OptLevel level) {
+  switch (level) {
+    case OPT_O1: return PipelineLevel::O1;
+    case OPT_O2: return PipelineLevel::O2;
+    case OPT_O3: return PipelineLevel::O3;
+    case OPT_Os: return PipelineLevel::Os;
+    case OPT_Oz: return PipelineLevel::Oz;
+    default:     internal("no pipeline for optimization level %d", level);
+  }
+  return PipelineLevel::O0;
+}
+
+// name of the IR unit a pass runs on (for --print-passes)
+static std::string unitName(llvm::Any IR) {
+  if (llvm::any_isa<const llvm::Function *>(IR))
+    return llvm::any_cast<const llvm::Function *>(IR)->getName().str();
+  if (llvm::any_isa<const llvm::Module *>(IR))
+    return "module";
+  return "";
+}
+
+// print each pass just before it runs
+static void listPasses(llvm::PassInstrumentationCallbacks &PIC) {
+#if LLVM_VERSION_MAJOR >= 11
+  PIC.registerBeforeNonSkippedPassCallback([](llvm::StringRef P, llvm::Any IR) {
+    llvm::errs() << "pass " << P << " on " << unitName(IR) << "\n";
+  });
+#else
+  PIC.registerBeforePassCallback([](llvm::StringRef P, llvm::Any IR) {
+    llvm::errs() << "pass " << P << " on " << unitName(IR) << "\n";
+    return true;
+  });
+#endif
+}
+
+// a span for each pass (-ftime-trace)
+static void tracePasses(llvm::PassInstrumentationCallbacks &PIC) {
+#if LLVM_VERSION_MAJOR >= 11
+  PIC.registerBeforeNonSkippedPassCallback([](llvm::StringRef P, llvm::Any IR) {
+    traceBegin(P.str(), unitName(IR));
+  });
+  PIC.registerAfterPassCallback([](llvm::StringRef, llvm::Any, const llvm::PreservedAnalyses &) {
+    traceEnd();
+  });
+  PIC.registerAfterPassInvalidatedCallback([](llvm::StringRef, const llvm::PreservedAnalyses &) {
+    traceEnd();
+  });
+#else
+  PIC.registerBeforePassCallback([](llvm::StringRef P, llvm::Any IR) {
+    traceBegin(P.str(), unitName(IR));
+    return true;
+  });
+  PIC.registerAfterPassCallback([](llvm::StringRef, llvm::Any) {
+    traceEnd();
+  });
+  PIC.registerAfterPassInvalidatedCallback([](llvm::StringRef) {
+    traceEnd();
+  });
+#endif
+}
+
+/* ---------------------------------------------------------------------
+   ------------------------ THE OPTIMIZE FUNCTION ----------------------
+   ---- runs the default pipeline of the requested level on a module ---
+   --------------------------------------------------------------------- */
+
+void optimize(llvm::Module &M, OptLevel level, llvm::TargetMachine *TM) {
+  MemPhaseScope phase(PHASE_OPTIMIZE);
+
+  // opt refuses broken input, so do we
+  if (llvm::verifyModule(M, &llvm::errs()))
+    internal("\rinvalid IR produced for module %s", M.getName().str().c_str());
+
+  // -O0: nothing to do
+  if (level == OPT_O0) return;
+  TraceScope scope("Optimize", M.getName().str());
+
+  llvm::PassInstrumentationCallbacks PIC;
+  if (options.printPasses) listPasses(PIC);
+  if (tracing) tracePasses(PIC);
+
+  llvm::LoopAnalysisManager LAM;
+  llvm::FunctionAnalysisManager FAM;
+  llvm::CGSCCAnalysisManager CGAM;
+  llvm::ModuleAnalysisManager MAM;
+
+  llvm::PassBuilder PB(TM, llvm::PipelineTuningOptions(), llvm::None, &PIC);
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  llvm::ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(pipelineLevel(level));
+  MPM.run(M, MAM);
+}
+
+/* ---------------------------------------------------------------------
+   ----------- --incremental: optimize and cache one function ----------
+   ---- at a time, so that an edit only costs the functions it touched -
+   --------------------------------------------------------------------- */
+
+// the globals (functions, strings) that F refers to, in order of use
+static void collectGlobals(llvm::Value *V, llvm::SmallPtrSet<llvm::Value *, 16> &seen,
+                           std::vector<llvm::GlobalValue *> &globals) {
+  if (!llvm::isa<llvm::Constant>(V) || !seen.insert(V).second) return;
+  if (auto *G = llvm::dyn_cast<llvm::GlobalValue>(V)) {
+    globals.push_back(G);
+    return;
+  }
+  for (llvm::Value *Op : llvm::cast<llvm::Constant>(V)->operands())
+    collectGlobals(Op, seen, globals);
+}
+
+// a module with F as its only definition; what F uses is declared (or,
+// for strings, copied under names of its own), so that the module, and
+// its key, depend on nothing F does not
+static std::unique_ptr<llvm::Module> extractFunction(llvm::Function &F) {
+  llvm::Module &M = *F.getParent();
+  std::unique_ptr<llvm::Module> N(new llvm::Module(F.getName(), F.getContext()));
+  N->setTargetTriple(M.getTargetTriple());
+  N->setDataLayout(M.getDataLayout());
+
+  llvm::SmallPtrSet<llvm::Value *, 16> seen;
+  std::vector<llvm::GlobalValue *> globals;
+  seen.insert(&F);
+  for (auto &BB : F)
+    for (auto &I : BB)
+      for (llvm::Value *Op : I.operands())
+        collectGlobals(Op, seen, globals);
+
+  llvm::ValueToValueMapTy VMap;
+  int strings = 0;
+  for (llvm::GlobalValue *G : globals) {
+    if (auto *callee = llvm::dyn_cast<llvm::Function>(G))
+      VMap[callee] = llvm::Function::Create(callee->getFunctionType(),
+                                            llvm::Function::ExternalLinkage, callee->getName(), N.get());
+    else if (auto *GV = llvm::dyn_cast<llvm::GlobalVariable>(G)) {
+      auto *copy = new llvm::GlobalVariable(
+        *N, GV->getValueType(), GV->isConstant(), GV->getLinkage(),
+        GV->hasInitializer() ? GV->getInitializer() : nullptr,
+        GV->hasLocalLinkage() ? ".str." + std::to_string(strings++) : GV->getName()
+      );
+      copy->copyAttributesFrom(GV);
+      VMap[GV] = copy;
+    }
+    else internal("cannot extract function %s", F.getName().str().c_str());
+  }
+
+  llvm::Function *NF = llvm::Function::Create(F.getFunctionType(), F.getLinkage(), F.getName(), N.get());
+  VMap[&F] = NF;
+  auto arg = NF->arg_begin();
+  for (auto &A : F.args()) {
+    arg->setName(A.getName());
+    VMap[&A] = &*arg++;
+  }
+  llvm::SmallVector<llvm::ReturnInst *, 4> returns;
+#if LLVM_VERSION_MAJOR >= 13
+  llvm::CloneFunctionInto(NF, &F, VMap, llvm::CloneFunctionChangeType::DifferentModule, returns);
+#else
+  llvm::CloneFunctionInto(NF, &F, VMap, true, returns);
+#endif
+  // there is no debug info to carry over, but cloning leaves its list
+  if (llvm::NamedMDNode *CUs = N->getNamedMetadata("llvm.dbg.cu"))
+    if (CUs->getNumOperands() == 0) N->eraseNamedMetadata(CUs);
+  return N;
+}
+
+void optimizeIncrementally(llvm::Module &M, OptLevel level, llvm::TargetMachine *TM) {
+  MemPhaseScope phase(PHASE_OPTIMIZE);
+  if (llvm::verifyModule(M, &llvm::errs()))
+    internal("\rinvalid IR produced for module %s", M.getName().str().c_str());
+  if (level == OPT_O0) return;
+
+  // step 1: every function, optimized on its own or taken from the cache
+  std::vector<std::unique_ptr<llvm::Module>> parts;
+  unsigned long hits = 0, misses = 0;
+  long bytes = 0;
+  for (auto &F : M) {
+    if (F.isDeclaration()) continue;
+    std::unique_ptr<llvm::Module> part = extractFunction(F);
+    std::string ir, bc;
+    llvm::raw_string_ostream out(ir);
+    part->print(out, nullptr);
+    std::string key = functionKey(out.str());
+
+    if (cacheLoad(key, bc)) {
+      auto cached = llvm::parseBitcodeFile(llvm::MemoryBufferRef(bc, key), M.getContext());
+      if (cached) {
+        parts.push_back(std::move(*cached));
+        hits++;
+        continue;
+      }
+      llvm::consumeError(cached.takeError());
+    }
+    optimize(*part, level, TM);
+    llvm::raw_string_ostream code(bc);
+    bc.clear();
+    llvm::WriteBitcodeToFile(*part, code);
+    bytes += cacheSave(key, code.str());
+    parts.push_back(std::move(part));
+    misses++;
+  }
+  cacheCount(hits, misses, bytes);
+
+  // step 2: put them back together, in place of the unoptimized bodies
+  for (auto &F : M)
+    if (!F.isDeclaration()) F.deleteBody();
+  std::vector<llvm::GlobalVariable *> unused;
+  for (auto &G : M.globals()) {
+    G.removeDeadConstantUsers();
+    if (G.use_empty() && G.hasLocalLinkage()) unused.push_back(&G);
+  }
+  for (auto *G : unused) G->eraseFromParent();
+  for (auto &part : parts)
+    if (llvm::Linker::linkModules(M, std::move(part)))
+      internal("\rcannot link the optimized functions of module %s", M.getName().str().c_str());
+}
@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "general.hpp"
+#include "options.hpp"
+#include "cache.hpp"
+
+thread_local Options options = {
+  NULL,    // infile
+  NULL,    // infiles
+  0,       // numInfiles
+  1,       // jobs
+  "a.out", // outName
+  false,   // dumpIR
+  false,   // dumpFinal
+  false,   // noLink
+  false,   // saveTemps
+  false,   // run
+  false,   // cache
+  false,   // incremental
+  false,   // singlePass
+  NULL,    // timeTrace
+  false,   // memReport
+  false,   // symbolStats
+  OPT_O0,  // optLevel
+  false,   // printPasses
+  NULL,    // emitLl
+  NULL,    // emitBc
+  NULL,    // emitAsm
+  NULL,    // emitObj
+  NULL,    // emitAst
+  NULL,    // cpu
+  NULL     // features
+};
+
+static const char *usage =
+  "usage: alan [-O|-O0|-O1|-O2|-O3|-Os|-Oz] [-i|-f] [-c] [-o outname] [-x] [--save-temps] [--run]\n"
+  "            [--cache|--no-cache] [--incremental] [--single-pass] [-ftime-trace[=file]]\n"
+  "            [--mem-report] [--symbol-stats] [--emit-ll file] [--emit-bc file] [--emit-asm file]\n"
+  "            [--emit-obj file] [--emit-ast file] [-mcpu=cpu|native] [-mattr=features|native]\n"
+  "            [--print-passes] [infile]\n"
+  "       alan [-j jobs] [-O...] [-c] [--save-temps] [-mcpu=...] [-mattr=...] infile...\n"
+  "       alan --cache-stats\n"
+  "       alan --server socket\n"
+  "       alan --connect socket [options] [infile]\n"
+  "\n"
+  "  -O            optimize IR and final code (same as -O3)\n"
+  "  -i            read source code from stdin, print IR code to stdout\n"
+  "  -f            read source code from stdin, print final code to stdout\n"
+  "  -c            create object file <progname>.o and stop, skipping linking\n"
+  "  -o outname    name of the produced executable (default: a.out)\n"
+  "  --save-temps  also store IR and final code in <progname>.imm and .asm\n"
+  "  -x            do not store IR and final code (the default, kept for alanc)\n"
+  "  --run         execute infile right away (JIT), without creating an executable\n"
+  "  --emit-*      write just the given outputs (\"-\" is stdout), no linking\n"
+  "  --emit-ast    write the checked AST, which can be given later instead of\n"
+  "                the source, to generate code without checking it again\n"
+  "  --cache       take objects and executables from the cache if they were built\n"
+  "                before (the default if $ALAN_CACHE_DIR is set; else\n"
+  "                $XDG_CACHE_HOME/alan, or ~/.cache/alan)\n"
+  "  --cache-stats show hits, misses and size of the cache\n"
+  "  --incremental optimize each function on its own (no inlining across them)\n"
+  "                and keep it in the cache, so that unchanged ones are reused\n"
+  "  --single-pass generate the code of each statement as soon as it is checked,\n"
+  "                in one walk over the tree (the same code, none on errors)\n"
+  "  -ftime-trace  write where compile time goes to <progname>.json (or file),\n"
+  "                for chrome://tracing, and a summary to stderr\n"
+  "  --mem-report  print the peak RSS and the allocations of each phase and\n"
+  "                of each part of the compiler to stderr\n"
+  "  --symbol-stats\n"
+  "                print the load of the hash table of the symbol table, and\n"
+  "                how many slots its searches looked at, to stderr\n"
+  "  -j jobs       compile that many infiles at once; each one gets its own\n"
+  "                <progname> executable (or <progname>.o with -c)\n"
+  "  --server      serve compilations on a Unix socket, from a warm process\n"
+  "  --connect     have the server listening on socket do this compilation";
+
+// translate the argument of -O to an optimization level
+static OptLevel parseOptLevel(const char *level) {
+  if (!strcmp(level, "")) return OPT_O3;   // plain -O, as in alanc
+  if (!strcmp(level, "0")) return OPT_O0;
+  if (!strcmp(level, "1")) return OPT_O1;
+  if (!strcmp(level, "2")) return OPT_O2;
+  if (!strcmp(level, "3")) return OPT_O3;
+  if (!strcmp(level, "s")) return OPT_Os;
+  if (!strcmp(level, "z")) return OPT_Oz;
+  fatal("\runknown optimization level -O%s\n%s", level, usage);
+  return OPT_O0;
+}
+
+// the argument that follows option argv[*i] (e.g. the file of --emit-obj)
+static const char *optionArgument(int argc, char *argv[], int *i) {
+  if (*i + 1 >= argc)
+    fatal("\roption %s expects an argument\n%s", argv[*i], usage);
+  return argv[++(*i)];
+}
+
+// program name: infile without its directory and .alan (or .ast) suffix
+const char *programName(const char *infile) {
+  if (infile == NULL) return "alan_from_stdin";
+  std::string name = infile;
+  size_t slash = name.rfind('/');
+  if (slash != std::string::npos) name = name.substr(slash + 1);
+  size_t len = name.length();
+  if (len > 5 && name.compare(len - 5, 5, ".alan") == 0) name = name.substr(0, len - 5);
+  else if (len > 4 && name.compare(len - 4, 4, ".ast") == 0) name = name.substr(0, len - 4);
+  return strdup(name.c_str());
+}
+
+// the number of -j (a positive integer)
+static int parseJobs(const char *jobs) {
+  char *end;
+  long n = strtol(jobs, &end, 10);
+  if (*jobs == '\0' || *end != '\0' || n < 1 || n > 1024)
+    fatal("\rthe number of jobs must be a positive integer, not %s\n%s", jobs, usage);
+  return n;
+}
+
+void parseOptions(int argc, char *argv[]) {
+  static std::vector<const char *> infiles;
+  bool outGiven = false;
+  const char *cacheDir = getenv("ALAN_CACHE_DIR");
+  options.cache = cacheDir != NULL && cacheDir[0] != '\0';
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+      fprintf(stderr, "%s\n", usage);
+      exit(0);
+    }
+    else if (!strcmp(arg, "--cache-stats")) {
+      printCacheStats();
+      exit(0);
+    }
+    else if (!strcmp(arg, "-i"))
+      options.dumpIR = true;
+    else if (!strcmp(arg, "-f"))
+      options.dumpFinal = true;
+    else if (!strcmp(arg, "-c"))
+      options.noLink = true;
+    else if (!strcmp(arg, "-x"))
+      options.saveTemps = false;
+    else if (!strcmp(arg, "--save-temps"))
+      options.saveTemps = true;
+    else if (!strcmp(arg, "--cache"))
+      options.cache = true;
+    else if (!strcmp(arg, "--no-cache"))
+      options.cache = false;
+    else if (!strcmp(arg, "--incremental"))
+      options.incremental = true;
+    else if (!strcmp(arg, "--single-pass"))
+      options.singlePass = true;
+    else if (!strcmp(arg, "-ftime-trace"))
+      options.timeTrace = "";
+    else if (!strncmp(arg, "-ftime-trace=", 13))
+      options.timeTrace = arg + 13;
+    else if (!strcmp(arg, "--mem-report"))
+      options.memReport = true;
+    else if (!strcmp(arg, "--symbol-stats"))
+      options.symbolStats = true;
+    else if (!strcmp(arg, "-j"))
+      options.jobs = parseJobs(optionArgument(argc, argv, &i));
+    else if (!strncmp(arg, "-j", 2))
+      options.jobs = parseJobs(arg + 2);
+    else if (!strcmp(arg, "--run"))
+      options.run = true;
+    else if (!strcmp(arg, "-o")) {
+      options.outName = optionArgument(argc, argv, &i);
+      outGiven = true;
+    }
+    else if (!strncmp(arg, "-O", 2))
+      options.optLevel = parseOptLevel(arg + 2);
+    else if (!strcmp(arg, "--print-passes"))
+      options.printPasses = true;
+    else if (!strcmp(arg, "--emit-ll"))
+      options.emitLl = optionArgument(argc, argv, &i);
+    else if (!strcmp(arg, "--emit-bc"))
+      options.emitBc = optionArgument(argc, argv, &i);
+    else if (!strcmp(arg, "--emit-asm"))
+      options.emitAsm = optionArgument(argc, argv, &i);
+    else if (!strcmp(arg, "--emit-obj"))
+      options.emitObj = optionArgument(argc, argv, &i);
+    else if (!strcmp(arg, "--emit-ast"))
+      options.emitAst = optionArgument(argc, argv, &i);
+    else if (!strncmp(arg, "-mcpu=", 6))
+      options.cpu = arg + 6;
+    else if (!strncmp(arg, "-mattr=", 7))
+      options.features = arg + 7;
+    else if (arg[0] == '-')
+      fatal("\runknown option %s\n%s", arg, usage);
+    else
+      infiles.push_back(arg);
+  }
+  if (!infiles.empty()) {
+    options.infile = infiles[0];
+    options.infiles = infiles.data();
+    options.numInfiles = infiles.size();
+  }
+
+  bool dumpIROrFinal = options.dumpIR || options.dumpFinal;
+  bool emitGiven = options.emitLl || options.emitBc || options.emitAsm || options.emitObj || options.emitAst;
+
+  // the input comes from a single source (either a file or stdin)
+  if (dumpIROrFinal && options.infile != NULL)
+    fatal("\rusing the -i or the -f flag and providing an infile name are conflicting\n%s", usage);
+  // we actually have something to do :)
+  if (!dumpIROrFinal && !emitGiven && options.infile == NULL)
+    fatal("\reither one of the -i and -f flags or an infile name must be given\n%s", usage);
+  if (options.dumpIR && options.dumpFinal)
+    fatal("\rthe -i and -f flags are mutually exclusive\n%s", usage);
+  // a friendly reminder
+  if ((dumpIROrFinal || emitGiven) && outGiven)
+    fatal("\rusage of the -o flag along with the -i, -f or --emit-* flags is meaningless\n%s", usage);
+  // stdin belongs to the program being run
+  if (options.run && (dumpIROrFinal || options.noLink || outGiven || options.infile == NULL))
+    fatal("\r--run needs an infile and cannot be combined with -i, -f, -c or -o\n%s", usage);
+
+  // many infiles: each one gets outputs named after it
+  if (options.numInfiles > 1 && (dumpIROrFinal || emitGiven || outGiven || options.run))
+    fatal("\rmore than one infile given along with -i, -f, -o, --run or --emit-*\n%s", usage);
+
+  filename = programName(options.infile);
+}
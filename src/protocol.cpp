@@ -0,0 +1,132 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "protocol.hpp"
+#include "server.hpp"
+
+extern char **environ;
+
+static void putWord(std::string &msg, uint32_t w) {
+  msg.append((const char *) &w, sizeof(w));
+}
+
+void putStrings(std::string &msg, int n, char *strings[]) {
+  putWord(msg, n);
+  for (int i = 0; i < n; i++) {
+    uint32_t len = strlen(strings[i]);
+    putWord(msg, len);
+    msg.append(strings[i], len);
+  }
+}
+
+static bool getWord(const std::string &msg, size_t *pos, uint32_t *w) {
+  if (msg.size() - *pos < sizeof(*w)) return false;
+  memcpy(w, msg.data() + *pos, sizeof(*w));
+  *pos += sizeof(*w);
+  return true;
+}
+
+bool getStrings(const std::string &msg, size_t *pos, std::vector<std::string> &strings) {
+  uint32_t n, len;
+  if (!getWord(msg, pos, &n)) return false;
+  for (uint32_t i = 0; i < n; i++) {
+    if (!getWord(msg, pos, &len) || msg.size() - *pos < len) return false;
+    strings.push_back(msg.substr(*pos, len));
+    *pos += len;
+  }
+  return true;
+}
+
+bool writeAll(int fd, const void *buf, size_t n) {
+  const char *p = (const char *) buf;
+  while (n > 0) {
+    ssize_t k = write(fd, p, n);
+    if (k < 0 && errno == EINTR) continue;
+    if (k <= 0) return false;
+    p += k, n -= k;
+  }
+  return true;
+}
+
+bool readAll(int fd, void *buf, size_t n) {
+  char *p = (char *) buf;
+  while (n > 0) {
+    ssize_t k = read(fd, p, n);
+    if (k < 0 && errno == EINTR) continue;
+    if (k <= 0) return false;
+    p += k, n -= k;
+  }
+  return true;
+}
+
+bool socketAddress(const char *path, struct sockaddr_un *addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr->sun_path)) return false;
+  strcpy(addr->sun_path, path);
+  return true;
+}
+
+/* ---------------------------------------------------------------------
+   ------------------------------- client ------------------------------
+   --------------------------------------------------------------------- */
+
+int request(const char *path, int argc, char *argv[]) {
+  struct sockaddr_un addr;
+  if (!socketAddress(path, &addr)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0) return -1;
+  if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+    close(sock);
+    return -1;
+  }
+
+  char cwd[PATH_MAX];
+  char *dir = getcwd(cwd, sizeof(cwd));
+  if (dir == NULL) {
+    close(sock);
+    return -1;
+  }
+  int envc = 0;
+  while (environ[envc] != NULL) envc++;
+
+  std::string msg;
+  putStrings(msg, argc, argv);
+  putStrings(msg, envc, environ);
+  putStrings(msg, 1, &dir);
+  uint32_t size = msg.size();
+
+  // the size goes first, together with our stdin, stdout and stderr
+  int fds[passedFds] = { 0, 1, 2 };
+  char control[CMSG_SPACE(sizeof(fds))];
+  memset(control, 0, sizeof(control));
+  struct iovec iov = { &size, sizeof(size) };
+  struct msghdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.msg_iov = &iov;
+  hdr.msg_iovlen = 1;
+  hdr.msg_control = control;
+  hdr.msg_controllen = sizeof(control);
+  struct cmsghdr *c = CMSG_FIRSTHDR(&hdr);
+  c->cmsg_level = SOL_SOCKET;
+  c->cmsg_type = SCM_RIGHTS;
+  c->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(c), fds, sizeof(fds));
+
+  int32_t status;
+  bool ok = sendmsg(sock, &hdr, 0) == sizeof(size) && writeAll(sock, msg.data(), msg.size()) &&
+            readAll(sock, &status, sizeof(status));
+  close(sock);
+  if (!ok) {
+    errno = ECONNRESET;
+    return -1;
+  }
+  return status;
+}
@@ -0,0 +1,340 @@
+/* ---------------------------------------------------------------------
+   ---- the lexer of bin/alan: a hand-written scanner over the mapped ---
+   ---- source, that skips blanks and comments and finds the ends of ---
+   ---- identifiers and numbers a vector (16 or 32 bytes) at a time; ----
+   ---- it returns the tokens of src/lexer.l, with the same lines ------
+   --------------------------------------------------------------------- */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.hpp"
+#include "source.hpp"
+#include "parser.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+void yyerror (const char *msg);
+
+thread_local char *yytext = (char *) "";   // the last token (not NUL-terminated)
+thread_local int yyleng = 0;
+
+static thread_local const char *cursor;     // where the next token starts looking
+
+void scanSource() {
+  cursor = sourceText;
+}
+
+/* ---------------------------------------------------------------------
+   ------------- byte classes, a block of the source at once -----------
+   --------------------------------------------------------------------- */
+
+#if defined(__AVX2__)
+typedef __m256i Block;
+static const int BLOCK = 32;
+static inline Block load(const char *p) { return _mm256_loadu_si256((const __m256i *) p); }
+static inline Block splat(char c) { return _mm256_set1_epi8(c); }
+static inline Block eq(Block a, char c) { return _mm256_cmpeq_epi8(a, splat(c)); }
+static inline Block either(Block a, Block b) { return _mm256_or_si256(a, b); }
+static inline Block lower(Block a) { return _mm256_or_si256(a, splat(0x20)); }
+static inline unsigned bits(Block a) { return (unsigned) _mm256_movemask_epi8(a); }
+// bytes in [lo, hi]: moved to the bottom of the signed range, where
+// one comparison is enough
+static inline Block range(Block a, char lo, char hi) {
+  Block shifted = _mm256_add_epi8(a, splat((char) (-128 - lo)));
+  return _mm256_cmpgt_epi8(splat((char) (-128 + hi - lo + 1)), shifted);
+}
+#elif defined(__SSE2__)
+typedef __m128i Block;
+static const int BLOCK = 16;
+static inline Block load(const char *p) { return _mm_loadu_si128((const __m128i *) p); }
+static inline Block splat(char c) { return _mm_set1_epi8(c); }
+static inline Block eq(Block a, char c) { return _mm_cmpeq_epi8(a, splat(c)); }
+static inline Block either(Block a, Block b) { return _mm_or_si128(a, b); }
+static inline Block lower(Block a) { return _mm_or_si128(a, splat(0x20)); }
+static inline unsigned bits(Block a) { return (unsigned) _mm_movemask_epi8(a); }
+static inline Block range(Block a, char lo, char hi) {
+  Block shifted = _mm_add_epi8(a, splat((char) (-128 - lo)));
+  return _mm_cmplt_epi8(shifted, splat((char) (-128 + hi - lo + 1)));
+}
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+// classes as bitmasks of a block, one bit per byte
+static inline unsigned identBits(Block b) {
+  return bits(either(either(range(lower(b), 'a', 'z'), range(b, '0', '9')), eq(b, '_')));
+}
+static inline unsigned digitBits(Block b) { return bits(range(b, '0', '9')); }
+static inline unsigned blankBits(Block b) {
+  return bits(either(either(eq(b, ' '), eq(b, '\t')), either(eq(b, '\r'), eq(b, '\n'))));
+}
+static inline unsigned newlineBits(Block b) { return bits(eq(b, '\n')); }
+// what a comment body ends at ("(*" nests, "*)" closes) and the end
+static inline unsigned commentStopBits(Block b) {
+  return bits(either(either(eq(b, '('), eq(b, '*')), eq(b, '\0')));
+}
+static inline unsigned lineEndBits(Block b) { return bits(either(eq(b, '\n'), eq(b, '\0'))); }
+
+static const unsigned ALL = (unsigned) ((1ull << BLOCK) - 1);
+
+// the first byte set in stop (BLOCK if none)
+static inline int first(unsigned stop) {
+  return stop ? __builtin_ctz(stop) : BLOCK;
+}
+
+// the newlines among the first n bytes of the block
+static inline int newlinesBefore(unsigned newlines, int n) {
+  return __builtin_popcount(newlines & (unsigned) ((1ull << n) - 1));
+}
+
+// the source has enough NULs after its end (SOURCE_PADDING) for a
+// whole block to be read at any position up to there, and NUL is in
+// none of the classes that are skipped over
+
+static inline const char *skipIdent(const char *p) {
+  for (;;) {
+    int n = first(~identBits(load(p)) & ALL);
+    p += n;
+    if (n < BLOCK) return p;
+  }
+}
+
+static inline const char *skipDigits(const char *p) {
+  for (;;) {
+    int n = first(~digitBits(load(p)) & ALL);
+    p += n;
+    if (n < BLOCK) return p;
+  }
+}
+
+static inline const char *skipBlanks(const char *p) {
+  // mostly, tokens are one space apart (or none)
+  if (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') return p;
+  if (p[1] != ' ' && p[1] != '\t' && p[1] != '\r' && p[1] != '\n') {
+    if (*p == '\n') linecount++;
+    return p + 1;
+  }
+  for (;;) {
+    Block b = load(p);
+    int n = first(~blankBits(b) & ALL);
+    linecount += newlinesBefore(newlineBits(b), n);
+    p += n;
+    if (n < BLOCK) return p;
+  }
+}
+
+static inline const char *skipCommentBody(const char *p) {
+  for (;;) {
+    Block b = load(p);
+    int n = first(commentStopBits(b));
+    linecount += newlinesBefore(newlineBits(b), n);
+    p += n;
+    if (n < BLOCK) return p;
+  }
+}
+
+static inline const char *skipToLineEnd(const char *p) {
+  for (;;) {
+    int n = first(lineEndBits(load(p)));
+    p += n;
+    if (n < BLOCK) return p;
+  }
+}
+
+#else
+
+/* ---------------------------------------------------------------------
+   ------------------- the same, a byte at a time ----------------------
+   --------------------------------------------------------------------- */
+
+static inline bool isIdent(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static inline const char *skipIdent(const char *p) {
+  while (isIdent(*p)) p++;
+  return p;
+}
+
+static inline const char *skipDigits(const char *p) {
+  while (*p >= '0' && *p <= '9') p++;
+  return p;
+}
+
+static inline const char *skipBlanks(const char *p) {
+  for (;; p++)
+    if (*p == '\n') linecount++;
+    else if (*p != ' ' && *p != '\t' && *p != '\r') return p;
+}
+
+static inline const char *skipCommentBody(const char *p) {
+  for (;; p++)
+    if (*p == '\n') linecount++;
+    else if (*p == '(' || *p == '*' || *p == '\0') return p;
+}
+
+static inline const char *skipToLineEnd(const char *p) {
+  while (*p != '\n' && *p != '\0') p++;
+  return p;
+}
+
+#endif
+
+/* ---------------------------------------------------------------------
+   ------------------------------ tokens -------------------------------
+   --------------------------------------------------------------------- */
+
+static inline bool atEnd(const char *p) {
+  return p >= sourceText + sourceLength;
+}
+
+static inline int token(const char *start, const char *end, int t) {
+  yytext = (char *) start;
+  yyleng = end - start;
+  cursor = end;
+  return t;
+}
+
+static int keyword(const char *p, int length) {
+  switch (length) {
+    case 2: if (!memcmp(p, "if", 2)) return T_if; break;
+    case 3: if (!memcmp(p, "int", 3)) return T_int; break;
+    case 4:
+      if (!memcmp(p, "byte", 4)) return T_byte;
+      if (!memcmp(p, "else", 4)) return T_else;
+      if (!memcmp(p, "proc", 4)) return T_proc;
+      if (!memcmp(p, "true", 4)) return T_true;
+      break;
+    case 5:
+      if (!memcmp(p, "false", 5)) return T_false;
+      if (!memcmp(p, "while", 5)) return T_while;
+      break;
+    case 6: if (!memcmp(p, "return", 6)) return T_return; break;
+    case 9: if (!memcmp(p, "reference", 9)) return T_reference; break;
+  }
+  return T_id;
+}
+
+// the end of the character literal at p ('c' or '\e'), NULL if none
+static const char *charLiteral(const char *p) {
+  if (p[1] == '\\') {
+    if (p[2] != '\0' && strchr("ntr0\\'\"", p[2]) && p[3] == '\'') return p + 4;
+    if (p[2] == 'x' && isxdigit((unsigned char) p[3]) && isxdigit((unsigned char) p[4]) && p[5] == '\'')
+      return p + 6;
+    return NULL;
+  }
+  if (p[1] != '\n' && p[1] != '\'' && p[1] != '"' && !atEnd(p + 1) && p[2] == '\'') return p + 3;
+  return NULL;
+}
+
+// the end of the string literal at p, NULL if none (lexer.l does not
+// allow newlines or '^' in them)
+static const char *stringLiteral(const char *p) {
+  for (p++; !atEnd(p); p++)
+    switch (*p) {
+      case '"':  return p + 1;
+      case '\n':
+      case '^':  return NULL;
+      case '\\':
+        if (p[1] == '\n' || atEnd(p + 1)) return NULL;
+        p++;
+        break;
+    }
+  return NULL;
+}
+
+// the newline that ends the "--" comment at p (or the end, if none)
+static const char *lineEnd(const char *p) {
+  p = skipToLineEnd(p);
+  while (*p == '\0' && !atEnd(p)) p = skipToLineEnd(p + 1);
+  return p;
+}
+
+// skip a (* nested *) comment, opened just before p; false if the
+// source ends in it
+static bool skipComment(const char *&p) {
+  int nesting_level = 1;
+  for (;;) {
+    p = skipCommentBody(p);
+    if (*p == '(') {
+      if (p[1] == '*') {
+        nesting_level++;
+        p++;
+      }
+      p++;
+    }
+    else if (*p == '*') {
+      while (*p == '*') p++;
+      if (*p == ')') {
+        p++;
+        if (--nesting_level == 0) return true;
+      }
+    }
+    else if (atEnd(p)) return false;
+    else p++;   // a NUL in the source
+  }
+}
+
+int yylex(YYSTYPE *lval) {
+  const char *p = cursor;
+  for (;;) {
+    p = skipBlanks(p);
+    if (atEnd(p)) return token(p, p, 0);
+    const char *q;
+    char c = *p;
+
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+      q = skipIdent(p + 1);
+      int t = keyword(p, q - p);
+      if (t == T_id) lval->sym = intern(p, q - p);
+      return token(p, q, t);
+    }
+    if (c >= '0' && c <= '9') {
+      q = skipDigits(p + 1);
+      lval->n = atoi(p);
+      return token(p, q, T_const);
+    }
+
+    switch (c) {
+      case '\'':
+        if ((q = charLiteral(p)) == NULL) break;
+        lval->c = q - p == 3 ? p[1] : escapeChar((char *) p);
+        return token(p, q, T_char);
+      case '"':
+        if ((q = stringLiteral(p)) == NULL) break;
+        lval->span.text = p;
+        lval->span.length = q - p;
+        return token(p, q, T_string);
+      case '-':
+        // "--".*\n: without a newline to end it, it is two minuses
+        if (p[1] == '-' && *(q = lineEnd(p + 2)) == '\n') {
+          linecount++;
+          p = q + 1;
+          continue;
+        }
+        return token(p, p + 1, c);
+      case '(':
+        if (p[1] == '*') {
+          p += 2;
+          if (!skipComment(p)) return token(p, p, 0);
+          continue;
+        }
+        return token(p, p + 1, c);
+      case '=': if (p[1] == '=') return token(p, p + 2, T_eq); return token(p, p + 1, c);
+      case '!': if (p[1] == '=') return token(p, p + 2, T_ne); return token(p, p + 1, c);
+      case '<': if (p[1] == '=') return token(p, p + 2, T_le); return token(p, p + 1, c);
+      case '>': if (p[1] == '=') return token(p, p + 2, T_ge); return token(p, p + 1, c);
+      case '+': case '*': case '/': case '%': case '&': case '|':
+      case ')': case '[': case ']': case '{': case '}': case ',': case ':': case ';':
+        return token(p, p + 1, c);
+    }
+    // reported, and the parser gives up without a message of its own
+    token(p, p + 1, YYerror);
+    yyerror("illegal token");
+    return YYerror;
+  }
+}
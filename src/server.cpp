@@ -0,0 +1,150 @@
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "general.hpp"
+#include "emit.hpp"
+#include "compile.hpp"
+#include "protocol.hpp"
+#include "server.hpp"
+
+extern char **environ;
+
+static const char *socketPath;
+
+static void removeSocket(int sig) {
+  unlink(socketPath);
+  signal(sig, SIG_DFL);
+  raise(sig);
+}
+
+// receive the request on conn; the passed fds end up in fds
+static bool receiveRequest(int conn, int fds[], std::string &msg) {
+  uint32_t size;
+  char control[CMSG_SPACE(passedFds * sizeof(int))];
+  struct iovec iov = { &size, sizeof(size) };
+  struct msghdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.msg_iov = &iov;
+  hdr.msg_iovlen = 1;
+  hdr.msg_control = control;
+  hdr.msg_controllen = sizeof(control);
+
+  ssize_t k;
+  do k = recvmsg(conn, &hdr, MSG_WAITALL); while (k < 0 && errno == EINTR);
+  if (k != sizeof(size)) return false;
+  struct cmsghdr *c = CMSG_FIRSTHDR(&hdr);
+  if (c == NULL || c->cmsg_type != SCM_RIGHTS || c->cmsg_len != CMSG_LEN(passedFds * sizeof(int)))
+    return false;
+  memcpy(fds, CMSG_DATA(c), passedFds * sizeof(int));
+
+  msg.resize(size);
+  return readAll(conn, &msg[0], size);
+}
+
+// the compilation itself, in a process of its own: it may exit at any
+// point (fatal errors, --run), which must not take the server down
+static void work(int conn, int fds[], const std::string &msg, Job job) {
+  std::vector<std::string> args, env, cwd;
+  size_t pos = 0;
+  if (!getStrings(msg, &pos, args) || !getStrings(msg, &pos, env) ||
+      !getStrings(msg, &pos, cwd) || args.empty() || cwd.size() != 1)
+    _exit(2);
+
+  for (int i = 0; i < passedFds; i++) {
+    dup2(fds[i], i);
+    close(fds[i]);
+  }
+  close(conn);
+  if (chdir(cwd[0].c_str()) < 0)
+    fatal("\rcannot enter %s", cwd[0].c_str());
+
+  std::vector<char *> argv, envp;
+  for (auto &a : args) argv.push_back(&a[0]);
+  for (auto &e : env) envp.push_back(&e[0]);
+  argv.push_back(NULL);
+  envp.push_back(NULL);
+  environ = envp.data();
+  exit(job(args.size(), argv.data()));
+}
+
+// one connection: run the job and report how it ended
+static void handle(int conn, Job job) {
+  int fds[passedFds];
+  std::string msg;
+  if (!receiveRequest(conn, fds, msg)) _exit(1);
+
+  pid_t pid = fork();
+  if (pid == 0) work(conn, fds, msg, job);
+  for (int i = 0; i < passedFds; i++) close(fds[i]);
+
+  int status, result = 1;
+  if (pid > 0 && waitpid(pid, &status, 0) == pid) {
+    if (WIFEXITED(status)) result = WEXITSTATUS(status);
+    else if (WIFSIGNALED(status)) result = 128 + WTERMSIG(status);
+  }
+  int32_t reply = result;
+  writeAll(conn, &reply, sizeof(reply));
+  _exit(0);
+}
+
+int serve(const char *path, Job job) {
+  struct sockaddr_un addr;
+  if (!socketAddress(path, &addr))
+    fatal("\rsocket path too long: %s", path);
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0) fatal("\rcannot create a socket: %s", strerror(errno));
+
+  // a socket left behind by a server that is gone can be reused
+  struct stat st;
+  if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode) &&
+      connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0 && errno == ECONNREFUSED)
+    unlink(path);
+
+  // only we may connect: the workers act on behalf of the client
+  mode_t mask = umask(077);
+  if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+    fatal("\rcannot bind to %s: %s", path, strerror(errno));
+  umask(mask);
+  if (listen(sock, SOMAXCONN) < 0)
+    fatal("\rcannot listen on %s: %s", path, strerror(errno));
+
+  socketPath = path;
+  signal(SIGINT, removeSocket);
+  signal(SIGTERM, removeSocket);
+  signal(SIGPIPE, SIG_IGN);
+
+  // the warm state every worker starts from
+  initTargets();
+  prepareCompiler();
+  fflush(NULL);
+
+  // handlers are not waited for
+  signal(SIGCHLD, SIG_IGN);
+  while (true) {
+    int conn = accept(sock, NULL, NULL);
+    if (conn < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      fatal("\rcannot accept on %s: %s", path, strerror(errno));
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(sock);
+      signal(SIGCHLD, SIG_DFL);
+      signal(SIGINT, SIG_DFL);
+      signal(SIGTERM, SIG_DFL);
+      handle(conn, job);
+    }
+    if (pid < 0) error("\rcannot fork: %s", strerror(errno));
+    close(conn);
+  }
+  return 0;
+}
@@ -0,0 +1,67 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "general.hpp"
+#include "source.hpp"
+
+thread_local char *sourceText;
+thread_local size_t sourceLength;
+
+// stdin cannot be mapped: read it into a buffer that keeps room for
+// the padding after what has been read so far
+static void readSource(int fd) {
+  size_t size = 1 << 16;
+  ssize_t n;
+  sourceText = (char *) mynew(size);
+  sourceLength = 0;
+  for (;;) {
+    if (sourceLength + SOURCE_PADDING == size) {
+      size *= 2;
+      if ((sourceText = (char *) realloc(sourceText, size)) == NULL)
+        fatal("\rOut of memory");
+    }
+    n = read(fd, sourceText + sourceLength, size - SOURCE_PADDING - sourceLength);
+    if (n == 0) break;
+    if (n < 0) fatal("\rcannot read the source: %s", strerror(errno));
+    sourceLength += n;
+  }
+  memset(sourceText + sourceLength, 0, SOURCE_PADDING);
+}
+
+void openSource(const char *infile) {
+  if (infile == NULL) {
+    readSource(0);
+    return;
+  }
+
+  int fd = open(infile, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0)
+    fatal("\rcannot open %s", infile);
+  if (!S_ISREG(st.st_mode)) {
+    readSource(fd);
+    close(fd);
+    return;
+  }
+
+  // zeroed pages for the file and its padding, with the file mapped
+  // over them (the rest of its last page reads as zeros too); private
+  // and writable, as flex (when it is the lexer) briefly puts a NUL
+  // after each token
+  long page = sysconf(_SC_PAGESIZE);
+  size_t size = (st.st_size + SOURCE_PADDING + page - 1) / page * page;
+  void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED)
+    fatal("\rcannot map %s: %s", infile, strerror(errno));
+  if (st.st_size > 0 &&
+      mmap(base, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    fatal("\rcannot map %s: %s", infile, strerror(errno));
+  close(fd);
+  sourceText = (char *) base;
+  sourceLength = st.st_size;
+}
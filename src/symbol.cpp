@@ -29,17 +29,47 @@
 #include "general.hpp"
 #include "error.hpp"
 #include "symbol.hpp"
+#include "memreport.hpp"
 
 /* ---------------------------------------------------------------------
    -------------      --------------
    --------------------------------------------------------------------- */
 
-Scope        * currentScope;           /*                */
-unsigned int   quadNext;               /*         */
-unsigned int   tempNumber;             /*   temporaries       */
-
-static unsigned int   hashTableSize;   /*    */
-static SymbolEntry ** hashTable;       /*          */
+thread_local Scope        * currentScope;           /*                */
+thread_local unsigned int   quadNext;               /*         */
+thread_local unsigned int   tempNumber;             /*   temporaries       */
+static thread_local unsigned int functionNumber;   /* Of the next function declared  */
+
+/* The hash table: open addressing (linear probing) over a power of
+   two slots, a slot for every name declared so far, which holds the
+   entries of that name, innermost first. The slot of a name is found
+   by Fibonacci hashing of its (FNV-1a) hash, so that the low bits of
+   the hash are not all that counts. At most half of the slots are
+   taken: then the table doubles. */
+
+typedef struct {
+    const char   * id;                   /* NULL: a free slot              */
+    unsigned int   hash;
+    SymbolEntry  * entries;              /* Of the name, innermost first   */
+} Slot;
+
+static thread_local unsigned int   hashTableBits;   /* log2 of the slots  */
+static thread_local unsigned int   hashTableSize;   /*    */
+static thread_local unsigned int   hashTableUsed;   /* Slots taken        */
+static thread_local Slot         * hashTable;       /*          */
+static thread_local SymbolTableStats stats;
+
+/* Entries, scopes and the strings of constants come from symbolArena,
+   in stack order: a scope is allocated first, then what is declared
+   in it, and closing it rewinds the arena to before it. Parameters
+   outlive the scope they are declared in (the function, one scope
+   out, keeps them for its calls, and for the redeclaration of a
+   forward one), so they come from parameterArena, in stack order
+   too: closing a scope rewinds that to the end of its parameters,
+   and so frees those of the functions declared in it. */
+
+static thread_local Arena          symbolArena(MEM_SYMBOLS);
+static thread_local Arena          parameterArena(MEM_SYMBOLS);
 
 static struct Type_tag typeConst [] = {
     { TYPE_VOID,    NULL, 0, 0 },
@@ -55,37 +85,24 @@ const Type typeBoolean = &(typeConst[2]);
 const Type typeChar    = &(typeConst[3]);
 const Type typeReal    = &(typeConst[4]);
 
+/* The types that are made (arrays and pointers) are hash-consed:
+   there is one for every kind, refType and size, so that equal types
+   are the same pointer. The table is open addressed like the one of
+   the symbols, and they are bumped out of typeArena; they live until
+   forgetTypes(), and each thread has its own (the basic types above
+   are shared by every thread that compiles). */
+
+static thread_local unsigned int   typeTableBits;
+static thread_local unsigned int   typeTableSize;
+static thread_local unsigned int   typeTableUsed;
+static thread_local Type         * typeTable;
+static thread_local Arena          typeArena(MEM_TYPES);
+
 
 /* ---------------------------------------------------------------------
    -------       --------
    --------------------------------------------------------------------- */
 
-typedef unsigned long int HashType;
-
-static HashType PJW_hash (const char * key)
-{
-    /*
-     *  P.J. Weinberger's hashing function. See also:
-     *  Aho A.V., Sethi R. & Ullman J.D, "Compilers: Principles,
-     *  Techniques and Tools", Addison Wesley, 1986, pp. 433-437.
-     */
-
-    const HashType PJW_OVERFLOW =
-        (((HashType) 0xf) << (8 * sizeof(HashType) - 4));
-    const int PJW_SHIFT = (8 * (sizeof(HashType) - 1));
-    
-    HashType h, g;
-    
-    for (h = 0; *key != '\0'; key++) {
-        h = (h << 4) + (*key);
-        if ((g = h & PJW_OVERFLOW) != 0) {
-            h ^= g >> PJW_SHIFT;
-            h ^= g;
-        }
-    }
-    return h;
-}
-
 void strAppendChar (char * buffer, RepChar c)
 {
     switch (c) {
@@ -132,45 +149,119 @@ void strAppendString (char * buffer, RepString str)
    ------        ------
    --------------------------------------------------------------------- */
 
-void initSymbolTable (unsigned int size)
+static void allocateSlots (unsigned int bits)
 {
+    MemScope scope(MEM_SYMBOLS);
+
+    hashTableBits = bits;
+    hashTableSize = 1u << bits;
+    hashTableUsed = 0;
+    hashTable = (Slot *) mynew(hashTableSize * sizeof(Slot));
+    memset(hashTable, 0, hashTableSize * sizeof(Slot));
+}
+
+/* The slot of the name, or the free one where it would go; probes is
+   how many slots were looked at */
+
+static Slot * probeSlot (const char * id, unsigned int hash, unsigned int * probes)
+{
+    unsigned int mask = hashTableSize - 1;
+    unsigned int i    = (hash * 2654435769u) >> (32 - hashTableBits);
+
+    *probes = 1;
+    while (hashTable[i].id != NULL && hashTable[i].id != id) {
+        i = (i + 1) & mask;
+        (*probes)++;
+    }
+    return &(hashTable[i]);
+}
+
+/* The same, for a search (declaration or lookup): --symbol-stats counts
+   these, not the bookkeeping of closeScope() and claimSlot() */
+
+static Slot * findSlot (const char * id, unsigned int hash)
+{
+    unsigned int probes;
+    Slot       * slot = probeSlot(id, hash, &probes);
+
+    stats.searches++;
+    stats.probes += probes;
+    if (probes > stats.longestProbe)
+        stats.longestProbe = probes;
+    return slot;
+}
+
+static void growSymbolTable (void)
+{
+    Slot       * old     = hashTable;
+    unsigned int oldSize = hashTableSize;
     unsigned int i;
+
+    allocateSlots(hashTableBits + 1);
+    for (i = 0; i < oldSize; i++)
+        if (old[i].id != NULL) {
+            unsigned int mask = hashTableSize - 1;
+            unsigned int j    = (old[i].hash * 2654435769u) >> (32 - hashTableBits);
+
+            while (hashTable[j].id != NULL)
+                j = (j + 1) & mask;
+            hashTable[j] = old[i];
+            hashTableUsed++;
+        }
+    mydelete(old);
+    stats.grows++;
+}
+
+void initSymbolTable (unsigned int size)
+{
+    unsigned int bits = 1;
     
     /*   */
     
     currentScope = NULL;
     quadNext     = 1;
     tempNumber   = 1;
+    functionNumber = 0;
     
     /*     */
+    /* (size slots at least) */
     
-    hashTableSize = size;
-    hashTable = (SymbolEntry **) mynew(size * sizeof(SymbolEntry *));
-    
-    for (i = 0; i < size; i++)
-        hashTable[i] = NULL;
+    while ((1u << bits) < size)
+        bits++;
+    allocateSlots(bits);
+    memset(&stats, 0, sizeof(stats));
 }
 
 void destroySymbolTable ()
 {
-    unsigned int i;
-    
     /*     */
     
-    for (i = 0; i < hashTableSize; i++)
-        if (hashTable[i] != NULL)
-            destroyEntry(hashTable[i]);
-
+    symbolArena.release();
+    parameterArena.release();
     mydelete(hashTable);
+    hashTable = NULL;
+    hashTableSize = hashTableUsed = 0;
+}
+
+SymbolTableStats symbolTableStats ()
+{
+    SymbolTableStats result = stats;
+
+    result.slots = hashTableSize;
+    result.names = hashTableUsed;
+    return result;
 }
 
 void openScope ()
 {
-    Scope * newScope = (Scope *) mynew(sizeof(Scope));
+    Arena::Mark mark = symbolArena.mark();
+    Scope * newScope = (Scope *) symbolArena.allocate(sizeof(Scope));
 
-    newScope->negOffset = START_NEGATIVE_OFFSET;
-    newScope->parent    = currentScope;
-    newScope->entries   = NULL;
+    newScope->mark          = mark;
+    newScope->parameterMark = parameterArena.mark();
+    newScope->negOffset     = START_NEGATIVE_OFFSET;
+    newScope->parent        = currentScope;
+    newScope->entries       = NULL;
 
     if (currentScope == NULL)
         newScope->nestingLevel = 1;
@@ -183,67 +274,93 @@ void openScope ()
 void closeScope ()
 {
     SymbolEntry * e = currentScope->entries;
-    Scope       * t = currentScope;
+    Arena::Mark   mark          = currentScope->mark;
+    Arena::Mark   parameterMark = currentScope->parameterMark;
     
+    /* The entries are only taken out of the hash table: their memory
+       goes all at once, with the scope */
+
     while (e != NULL) {
         SymbolEntry * next = e->nextInScope;
         
-        hashTable[e->hashValue] = e->nextHash;
-        destroyEntry(e);
+        unsigned int probes;
+
+        probeSlot(e->id, e->hashValue, &probes)->entries = e->nextHash;
         e = next;
     }
     
     currentScope = currentScope->parent;
-    mydelete(t);
+    symbolArena.rewind(mark);
+    parameterArena.rewind(parameterMark);
 }
 
-static void insertEntry (SymbolEntry * e)
+static void insertEntry (Slot * slot, SymbolEntry * e)
 {
-    e->nextHash             = hashTable[e->hashValue];
-    hashTable[e->hashValue] = e;
+    e->nextHash             = slot->entries;
+    slot->entries           = e;
     e->nextInScope          = currentScope->entries;
     currentScope->entries   = e;
 }
 
-static SymbolEntry * newEntry (const char * name)
+/* The slot of the name, taken for it if it was free (slot is what
+   findSlot() gave) */
+
+static Slot * claimSlot (Slot * slot, Symbol name)
+{
+    if (slot->id != NULL)
+        return slot;
+    if (2 * (hashTableUsed + 1) > hashTableSize) {
+        unsigned int probes;
+
+        growSymbolTable();
+        slot = probeSlot(name->text, name->hash, &probes);
+    }
+    slot->id   = name->text;
+    slot->hash = name->hash;
+    hashTableUsed++;
+    return slot;
+}
+
+static SymbolEntry * newEntry (Symbol name, Arena & arena = symbolArena)
 {
     SymbolEntry * e;
+    Slot        * slot = findSlot(name->text, name->hash);
     
     /*     */
+    /* (the innermost entry of the name would be of this scope) */
     
-    for (e = currentScope->entries; e != NULL; e = e->nextInScope)
-        if (strcmp(name, e->id) == 0) {
-            error("Duplicate identifier: %s", name);
-            return NULL;
-        }
+    if (slot->entries != NULL && slot->entries->nestingLevel == currentScope->nestingLevel) {
+        error("Duplicate identifier: %s", name->text);
+        return NULL;
+    }
 
-    /*   : entryType  u */
+    slot = claimSlot(slot, name);
 
-    e = (SymbolEntry *) mynew(sizeof(SymbolEntry));
-    e->id = (char *) mynew(strlen(name) + 1);
+    /*   : entryType  u */
 
-    strcpy((char *) (e->id), name);
-    e->hashValue    = PJW_hash(name) % hashTableSize;
+    e = (SymbolEntry *) arena.allocate(sizeof(SymbolEntry));
+    e->id           = name->text;
+    e->hashValue    = name->hash;
     e->nestingLevel = currentScope->nestingLevel;
-    insertEntry(e);
+    e->slot         = -1;
+    insertEntry(slot, e);
     return e;
 }
 
-SymbolEntry * newVariable (const char * name, Type type)
+SymbolEntry * newVariable (Symbol name, Type type)
 {
     SymbolEntry * e = newEntry(name);
     
     if (e != NULL) {
         e->entryType = ENTRY_VARIABLE;
         e->u.eVariable.type = type;
-        type->refCount++;
         currentScope->negOffset -= sizeOfType(type);
         e->u.eVariable.offset = currentScope->negOffset;
     }
     return e;
 }
 
-SymbolEntry * newConstant (const char * name, Type type, ...)
+SymbolEntry * newConstant (Symbol name, Type type, ...)
 {
     SymbolEntry * e;
     va_list ap;
@@ -274,8 +391,7 @@ SymbolEntry * newConstant (const char * name, Type type, ...)
             if (equalType(type->refType, typeChar)) {
                 RepString str = va_arg(ap, RepString);
                 
-                value.vString = (const char *) mynew(strlen(str) + 1);
-                strcpy((char *) (value.vString), str);
+                value.vString = symbolArena.copy(str, strlen(str));
                 break;
             }
         default:
@@ -311,7 +427,7 @@ SymbolEntry * newConstant (const char * name, Type type, ...)
             default:
                 internal("Invalid type of constant\n");
         }
-        e = newEntry(buffer);
+        e = newEntry(intern(buffer));
     }
     else
         e = newEntry(name);
@@ -319,7 +435,6 @@ SymbolEntry * newConstant (const char * name, Type type, ...)
     if (e != NULL) {
         e->entryType = ENTRY_CONSTANT;
         e->u.eConstant.type = type;
-        type->refCount++;
         switch (type->kind) {
             case TYPE_INTEGER:
                 e->u.eConstant.value.vInteger = value.vInteger;
@@ -342,7 +457,7 @@ SymbolEntry * newConstant (const char * name, Type type, ...)
     return e;
 }
 
-SymbolEntry * newFunction (const char * name)
+SymbolEntry * newFunction (Symbol name)
 {
     SymbolEntry * e = lookupEntry(name, LOOKUP_CURRENT_SCOPE, false);
 
@@ -354,6 +469,7 @@ SymbolEntry * newFunction (const char * name)
             e->u.eFunction.pardef = PARDEF_DEFINE;
             e->u.eFunction.firstArgument = e->u.eFunction.lastArgument = NULL;
             e->u.eFunction.resultType = NULL;
+            e->slot = functionNumber++;
         }
         return e;
     }
@@ -364,12 +480,12 @@ SymbolEntry * newFunction (const char * name)
         return e;
     }
     else {
-       error("Duplicate identifier: %s", name);
+       error("Duplicate identifier: %s", name->text);
        return NULL;
     }
 }
 
-SymbolEntry * newParameter (const char * name, Type type,
+SymbolEntry * newParameter (Symbol name, Type type,
                             PassMode mode, SymbolEntry * f)
 {
     SymbolEntry * e;
@@ -378,11 +494,10 @@ SymbolEntry * newParameter (const char * name, Type type,
         internal("Cannot add a parameter to a non-function\n");
     switch (f->u.eFunction.pardef) {
         case PARDEF_DEFINE:
-            e = newEntry(name);
+            e = newEntry(name, parameterArena);
             if (e != NULL) {
                 e->entryType = ENTRY_PARAMETER;
                 e->u.eParameter.type = type;
-                type->refCount++;
                 e->u.eParameter.mode = mode;
                 e->u.eParameter.next = NULL;
             }
@@ -408,11 +523,11 @@ SymbolEntry * newParameter (const char * name, Type type,
             else if (e->u.eParameter.mode != mode)
                 error("Parameter passing mode mismatch in redeclaration "
                       "of function %s", f->id);
-            else if (strcmp(e->id, name) != 0)
+            else if (e->id != name->text)
                 error("Parameter name mismatch in redeclaration "
                       "of function %s", f->id);
             else
-                insertEntry(e);
+                insertEntry(claimSlot(findSlot(name->text, name->hash), name), e);
             f->u.eFunction.lastArgument = e;
             return e;
         case PARDEF_COMPLETE:
@@ -454,7 +569,6 @@ void endFunctionHeader (SymbolEntry * f, Type type)
         case PARDEF_DEFINE:
             fixOffset(f->u.eFunction.firstArgument);
             f->u.eFunction.resultType = type;
-            type->refCount++;
             break;
         case PARDEF_CHECK:
             if ((f->u.eFunction.lastArgument != NULL &&
@@ -469,6 +583,11 @@ void endFunctionHeader (SymbolEntry * f, Type type)
             break;
     }
     f->u.eFunction.pardef = PARDEF_COMPLETE;
+
+    /* The parameters are the function's, one scope out: closing this
+       one keeps them */
+
+    currentScope->parameterMark = parameterArena.mark();
 }
 
 SymbolEntry * newTemporary (Type type)
@@ -477,12 +596,11 @@ SymbolEntry * newTemporary (Type type)
     SymbolEntry * e;
 
     sprintf(buffer, "$%d", tempNumber);
-    e = newEntry(buffer);
+    e = newEntry(intern(buffer));
     
     if (e != NULL) {
         e->entryType = ENTRY_TEMPORARY;
         e->u.eVariable.type = type;
-        type->refCount++;
         currentScope->negOffset -= sizeOfType(type);
         e->u.eTemporary.offset = currentScope->negOffset;
         e->u.eTemporary.number = tempNumber++;
@@ -490,121 +608,105 @@ SymbolEntry * newTemporary (Type type)
     return e;
 }
 
-void destroyEntry (SymbolEntry * e)
+SymbolEntry * lookupEntry (Symbol name, LookupType type, bool err)
 {
-    SymbolEntry * args;
-    
-    switch (e->entryType) {
-        case ENTRY_VARIABLE:
-            destroyType(e->u.eVariable.type);
-            break;
-        case ENTRY_CONSTANT:
-            if (e->u.eConstant.type->kind == TYPE_ARRAY)
-                mydelete((char *) (e->u.eConstant.value.vString));
-            destroyType(e->u.eConstant.type);
-            break;
-        case ENTRY_FUNCTION:
-            args = e->u.eFunction.firstArgument;
-            while (args != NULL) {
-                SymbolEntry * p = args;
-                
-                destroyType(args->u.eParameter.type);
-                mydelete((char *) (args->id));
-                args = args->u.eParameter.next;
-                mydelete(p);
-            }
-            destroyType(e->u.eFunction.resultType);
-            break;
-        case ENTRY_PARAMETER:
-            /*        */
-            return;
-        case ENTRY_TEMPORARY:
-            destroyType(e->u.eTemporary.type);
-            break;
-    }
-    mydelete((char *) (e->id));
-    mydelete(e);        
-}
-
-SymbolEntry * lookupEntry (const char * name, LookupType type, bool err)
-{
-    unsigned int  hashValue = PJW_hash(name) % hashTableSize;
-    SymbolEntry * e         = hashTable[hashValue];
+    SymbolEntry * e = findSlot(name->text, name->hash)->entries;
     
     switch (type) {
         case LOOKUP_CURRENT_SCOPE:
-            while (e != NULL && e->nestingLevel == currentScope->nestingLevel)
-                if (strcmp(e->id, name) == 0)
-                    return e;
-                else
-                    e = e->nextHash;
+            if (e != NULL && e->nestingLevel == currentScope->nestingLevel)
+                return e;
             break;
         case LOOKUP_ALL_SCOPES:
-            while (e != NULL)
-                if (strcmp(e->id, name) == 0)
-                    return e;
-                else
-                    e = e->nextHash;
+            if (e != NULL)
+                return e;
             break;
     }
     
     if (err)
-        error("Unknown identifier: %s", name);
+        error("Unknown identifier: %s", name->text);
     return NULL;
 }
 
-Type typeArray (RepInteger size, Type refType)
+static unsigned int typeHash (kind_t kind, Type refType, RepInteger size)
 {
-    Type n = (Type) mynew(sizeof(struct Type_tag));
-
-    n->kind     = TYPE_ARRAY;
-    n->refType  = refType;
-    n->size     = size;
-    n->refCount = 1;
-    
-    refType->refCount++;
-
-    return n;
+    unsigned long long key  = (unsigned long long) refType;
+    unsigned int       hash = 2166136261u;      /* FNV-1a, as names */
+
+    hash = (hash ^ (unsigned int) kind) * 16777619u;
+    hash = (hash ^ (unsigned int) key) * 16777619u;
+    hash = (hash ^ (unsigned int) (key >> 32)) * 16777619u;
+    hash = (hash ^ (unsigned int) size) * 16777619u;
+    return hash;
 }
 
-Type typeIArray (Type refType)
+static void growTypeTable (void)
 {
-    Type n = (Type) mynew(sizeof(struct Type_tag));
+    Type         * old = typeTable;
+    unsigned int   oldSize = typeTableSize;
+    unsigned int   i, j;
+
+    MemScope scope(MEM_TYPES);
+    typeTableBits = typeTableBits == 0 ? 6 : typeTableBits + 1;
+    typeTableSize = 1u << typeTableBits;
+    typeTable = (Type *) mynew(typeTableSize * sizeof(Type));
+    memset(typeTable, 0, typeTableSize * sizeof(Type));
+    for (i = 0; i < oldSize; i++)
+        if (old[i] != NULL) {
+            j = (old[i]->hash * 2654435769u) >> (32 - typeTableBits);
+            while (typeTable[j] != NULL)
+                j = (j + 1) & (typeTableSize - 1);
+            typeTable[j] = old[i];
+        }
+    mydelete(old);
+}
 
-    n->kind     = TYPE_IARRAY;
-    n->refType  = refType;
-    n->refCount = 1;
-    
-    refType->refCount++;
+/* The type of kind, refType and size: the same one every time */
 
-    return n;
+static Type makeType (kind_t kind, Type refType, RepInteger size)
+{
+    unsigned int hash, i;
+    Type         n;
+
+    if (2 * (typeTableUsed + 1) > typeTableSize)
+        growTypeTable();
+    hash = typeHash(kind, refType, size);
+    for (i = (hash * 2654435769u) >> (32 - typeTableBits);
+         (n = typeTable[i]) != NULL;
+         i = (i + 1) & (typeTableSize - 1))
+        if (n->kind == kind && n->refType == refType && n->size == size)
+            return n;
+
+    n = (Type) typeArena.allocate(sizeof(struct Type_tag));
+    n->kind    = kind;
+    n->refType = refType;
+    n->size    = size;
+    n->hash    = hash;
+    typeTableUsed++;
+    return typeTable[i] = n;
 }
 
-Type typePointer (Type refType)
+Type typeArray (RepInteger size, Type refType)
 {
-    Type n = (Type) mynew(sizeof(struct Type_tag));
+    return makeType(TYPE_ARRAY, refType, size);
+}
 
-    n->kind     = TYPE_POINTER;
-    n->refType  = refType;
-    n->refCount = 1;
-    
-    refType->refCount++;
+Type typeIArray (Type refType)
+{
+    return makeType(TYPE_IARRAY, refType, 0);
+}
 
-    return n;
+Type typePointer (Type refType)
+{
+    return makeType(TYPE_POINTER, refType, 0);
 }
 
-void destroyType (Type type)
+void forgetTypes ()
 {
-    switch (type->kind) {
-        case TYPE_ARRAY:
-        case TYPE_IARRAY:
-        case TYPE_POINTER:
-            if (--(type->refCount) == 0) {
-                destroyType(type->refType);
-                mydelete(type);
-            }
-        default: return;
-    }
+    typeArena.release();
+    mydelete(typeTable);
+    typeTable = NULL;
+    typeTableBits = typeTableSize = typeTableUsed = 0;
 }
 
 unsigned int sizeOfType (Type type)
@@ -629,20 +731,11 @@ unsigned int sizeOfType (Type type)
     return 0;
 }
 
+/* Types are hash-consed: equal types are the same one */
+
 bool equalType (Type type1, Type type2)
 {
-    if (type1->kind != type2->kind)
-        return false;
-    switch (type1->kind) {
-        case TYPE_ARRAY:
-            if (type1->size != type2->size)
-                return false;
-        case TYPE_IARRAY:
-        case TYPE_POINTER:
-            return equalType(type1->refType, type2->refType);
-        default: return true;
-    }
-    return true;        
+    return type1 == type2;
 }
 
 void printType (Type type)
@@ -693,101 +786,101 @@ void initLibFunctions() {
     SymbolEntry * f;
 
     /* writeInteger */
-    f = newFunction("writeInteger");
+    f = newFunction(intern("writeInteger"));
     openScope();
-    newParameter("n", typeInteger, PASS_BY_VALUE, f);
+    newParameter(intern("n"), typeInteger, PASS_BY_VALUE, f);
     endFunctionHeader(f, typeVoid);
     closeScope();
 
     /* writeByte */
-    f = newFunction("writeByte");
+    f = newFunction(intern("writeByte"));
     openScope();
-    newParameter("b", typeChar, PASS_BY_VALUE, f);
+    newParameter(intern("b"), typeChar, PASS_BY_VALUE, f);
     endFunctionHeader(f, typeVoid);
     closeScope();
 
     /* writeChar */
-    f = newFunction("writeChar");
+    f = newFunction(intern("writeChar"));
     openScope();
-    newParameter("n", typeChar, PASS_BY_VALUE, f);
+    newParameter(intern("n"), typeChar, PASS_BY_VALUE, f);
     endFunctionHeader(f, typeVoid);
     closeScope();
 
     /* writeString */
-    f = newFunction("writeString");
+    f = newFunction(intern("writeString"));
     openScope();
-    newParameter("s", typeIArray(typeChar), PASS_BY_REFERENCE, f);
+    newParameter(intern("s"), typeIArray(typeChar), PASS_BY_REFERENCE, f);
     endFunctionHeader(f, typeVoid);
     closeScope();
 
     /* readInteger */
-    f = newFunction("readInteger");
+    f = newFunction(intern("readInteger"));
     openScope();
     endFunctionHeader(f, typeInteger);
     closeScope();
 
     /* readByte */
-    f = newFunction("readByte");
+    f = newFunction(intern("readByte"));
     openScope();
     endFunctionHeader(f, typeChar);
     closeScope();
 
     /* readChar */
-    f = newFunction("readChar");
+    f = newFunction(intern("readChar"));
     openScope();
     endFunctionHeader(f, typeChar);
     closeScope();
 
     /* readString */
-    f = newFunction("readString");
+    f = newFunction(intern("readString"));
     openScope();
-    newParameter("n", typeInteger, PASS_BY_VALUE, f);
-    newParameter("s", typeIArray(typeChar), PASS_BY_REFERENCE, f);
+    newParameter(intern("n"), typeInteger, PASS_BY_VALUE, f);
+    newParameter(intern("s"), typeIArray(typeChar), PASS_BY_REFERENCE, f);
     endFunctionHeader(f, typeVoid);
     closeScope();
 
     /* extend */
-    f = newFunction("extend");
+    f = newFunction(intern("extend"));
     openScope();
-    newParameter("b", typeChar, PASS_BY_VALUE, f);
+    newParameter(intern("b"), typeChar, PASS_BY_VALUE, f);
     endFunctionHeader(f, typeInteger);
     closeScope();
 
     /* shrink */
-    f = newFunction("shrink");
+    f = newFunction(intern("shrink"));
     openScope();
-    newParameter("i", typeInteger, PASS_BY_VALUE, f);
+    newParameter(intern("i"), typeInteger, PASS_BY_VALUE, f);
     endFunctionHeader(f, typeChar);
     closeScope();
 
     /* strlen */
-    f = newFunction("strlen");
+    f = newFunction(intern("strlen"));
     openScope();
-    newParameter("s", typeIArray(typeChar), PASS_BY_REFERENCE, f);
+    newParameter(intern("s"), typeIArray(typeChar), PASS_BY_REFERENCE, f);
     endFunctionHeader(f, typeInteger);
     closeScope();
 
     /* strcmp */
-    f = newFunction("strcmp");
+    f = newFunction(intern("strcmp"));
     openScope();
-    newParameter("s1", typeIArray(typeChar), PASS_BY_REFERENCE, f);
-    newParameter("s2", typeIArray(typeChar), PASS_BY_REFERENCE, f);
+    newParameter(intern("s1"), typeIArray(typeChar), PASS_BY_REFERENCE, f);
+    newParameter(intern("s2"), typeIArray(typeChar), PASS_BY_REFERENCE, f);
     endFunctionHeader(f, typeInteger);
     closeScope();
 
     /* strcpy */
-    f = newFunction("strcpy");
+    f = newFunction(intern("strcpy"));
     openScope();
-    newParameter("trg", typeIArray(typeChar), PASS_BY_REFERENCE, f);
-    newParameter("src", typeIArray(typeChar), PASS_BY_REFERENCE, f);
+    newParameter(intern("trg"), typeIArray(typeChar), PASS_BY_REFERENCE, f);
+    newParameter(intern("src"), typeIArray(typeChar), PASS_BY_REFERENCE, f);
     endFunctionHeader(f, typeVoid);
     closeScope();
 
     /* strcat */
-    f = newFunction("strcat");
+    f = newFunction(intern("strcat"));
     openScope();
-    newParameter("trg", typeIArray(typeChar), PASS_BY_REFERENCE, f);
-    newParameter("src", typeIArray(typeChar), PASS_BY_REFERENCE, f);
+    newParameter(intern("trg"), typeIArray(typeChar), PASS_BY_REFERENCE, f);
+    newParameter(intern("src"), typeIArray(typeChar), PASS_BY_REFERENCE, f);
     endFunctionHeader(f, typeVoid);
     closeScope();
 }
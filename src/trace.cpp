@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "general.hpp"
+#include "trace.hpp"
+
+bool tracing = false;
+
+typedef struct {
+  std::string name;
+  std::string detail;
+  long long start, end;   // ns since traceStart
+} Span;
+
+static const char *tracePath;
+static long long origin;
+static std::vector<Span> spans;
+static std::vector<size_t> open;                   // indices into spans
+static std::map<std::string, long long> totals;    // traceAdd
+
+long long traceNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+}
+
+void traceBegin(const std::string &name, const std::string &detail) {
+  Span s = { name, detail, traceNow() - origin, -1 };
+  open.push_back(spans.size());
+  spans.push_back(s);
+}
+
+void traceEnd() {
+  if (open.empty()) internal("trace span closed twice");
+  spans[open.back()].end = traceNow() - origin;
+  open.pop_back();
+}
+
+void traceAdd(const char *name, long long nanoseconds) {
+  totals[name] += nanoseconds;
+}
+
+/* ---------------------------------------------------------------------
+   ------------------------------- output ------------------------------
+   --------------------------------------------------------------------- */
+
+static void writeString(FILE *f, const std::string &s) {
+  fputc('"', f);
+  for (unsigned char c : s) {
+    if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+    else if (c < 0x20) fprintf(f, "\\u%04x", c);
+    else fputc(c, f);
+  }
+  fputc('"', f);
+}
+
+static void writeTrace() {
+  FILE *f = fopen(tracePath, "w");
+  if (f == NULL) {
+    fprintf(stderr, "cannot write the time trace to %s\n", tracePath);
+    return;
+  }
+  fprintf(f, "{\"traceEvents\":[\n");
+  for (size_t i = 0; i < spans.size(); i++) {
+    const Span &s = spans[i];
+    fprintf(f, "{\"pid\":1,\"tid\":0,\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+            s.start / 1e3, (s.end - s.start) / 1e3);
+    writeString(f, s.name);
+    if (!s.detail.empty()) {
+      fprintf(f, ",\"args\":{\"detail\":");
+      writeString(f, s.detail);
+      fprintf(f, "}");
+    }
+    fprintf(f, "},\n");
+  }
+  // the totals, as counters at the end of the trace
+  for (auto &t : totals) {
+    fprintf(f, "{\"pid\":1,\"tid\":0,\"ph\":\"C\",\"ts\":0,\"name\":");
+    writeString(f, "Total " + t.first);
+    fprintf(f, ",\"args\":{\"ms\":%.3f}},\n", t.second / 1e6);
+  }
+  fprintf(f, "{\"pid\":1,\"tid\":0,\"ph\":\"M\",\"name\":\"process_name\",\"args\":{\"name\":");
+  writeString(f, std::string("alan ") + filename);
+  fprintf(f, "}}\n]}\n");
+  fclose(f);
+}
+
+// time per kind of span, largest first (self time leaves out the spans
+// nested in it), and the spans that took longest on their own
+static void writeSummary() {
+  typedef struct { long long total, self; int count; } Row;
+  std::map<std::string, Row> rows;
+  std::vector<long long> nested(spans.size(), 0);
+  std::vector<size_t> stack;
+  for (size_t i = 0; i < spans.size(); i++) {
+    while (!stack.empty() && spans[stack.back()].end <= spans[i].start) stack.pop_back();
+    if (!stack.empty()) nested[stack.back()] += spans[i].end - spans[i].start;
+    stack.push_back(i);
+  }
+  for (size_t i = 0; i < spans.size(); i++) {
+    Row &r = rows[spans[i].name];
+    r.total += spans[i].end - spans[i].start;
+    r.self += spans[i].end - spans[i].start - nested[i];
+    r.count++;
+  }
+  for (auto &t : totals) {
+    Row &r = rows[t.first];
+    r.total += t.second;
+    r.self += t.second;
+    r.count++;
+  }
+
+  std::vector<std::pair<std::string, Row>> sorted(rows.begin(), rows.end());
+  std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, Row> &a,
+                                             const std::pair<std::string, Row> &b) {
+    return a.second.total > b.second.total;
+  });
+  fprintf(stderr, "===== time trace of %s (%s) =====\n", filename, tracePath);
+  fprintf(stderr, "%12s %12s %8s  %s\n", "total ms", "self ms", "count", "name");
+  for (size_t i = 0; i < sorted.size() && i < 25; i++)
+    fprintf(stderr, "%12.3f %12.3f %8d  %s\n", sorted[i].second.total / 1e6,
+            sorted[i].second.self / 1e6, sorted[i].second.count, sorted[i].first.c_str());
+
+  std::vector<size_t> slowest;
+  for (size_t i = 0; i < spans.size(); i++)
+    if (!spans[i].detail.empty()) slowest.push_back(i);
+  std::sort(slowest.begin(), slowest.end(), [&](size_t a, size_t b) {
+    return spans[a].end - spans[a].start - nested[a] > spans[b].end - spans[b].start - nested[b];
+  });
+  if (!slowest.empty()) fprintf(stderr, "slowest by self time:\n");
+  for (size_t i = 0; i < slowest.size() && i < 10; i++) {
+    const Span &s = spans[slowest[i]];
+    fprintf(stderr, "%12.3f %12.3f %8s  %s %s\n", (s.end - s.start) / 1e6,
+            (s.end - s.start - nested[slowest[i]]) / 1e6, "", s.name.c_str(), s.detail.c_str());
+  }
+}
+
+static void finish() {
+  // whatever is still open (exit from within a span) ends now
+  while (!open.empty()) traceEnd();
+  tracing = false;
+  writeTrace();
+  writeSummary();
+}
+
+void traceStart(const char *path) {
+  tracePath = path;
+  origin = traceNow();
+  tracing = true;
+  atexit(finish);
+}